@@ -0,0 +1,132 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <algorithm>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <polar_grid_rviz_plugins/polar_grid_geometry.hpp>
+
+namespace polar_grid_rviz_plugins {
+
+  namespace {
+
+  size_t buildBands(
+    const PolarGridParams & params, std::vector < PolarGridGeometry > & bands,
+    std::vector < PolarGridGeometry > * spokes = nullptr)
+  {
+    size_t vertices = 0, chunk = 0;
+    for (int i = 0; i < bandCount(params); ++i) {
+      for (int j = 0; j < bandSlices(params, i); ++j, ++chunk) {
+        if (bands.size() < 2 * (chunk + 1)) {
+          bands.resize(2 * (chunk + 1));
+          if (spokes) {
+            spokes->resize(chunk + 1);
+          }
+        }
+        buildBand(params, i, j, RingTier::kMajor, bands[2 * chunk]);
+        buildBand(params, i, j, RingTier::kMinor, bands[2 * chunk + 1]);
+        vertices += (bands[2 * chunk].positions.size() + bands[2 * chunk + 1].positions.size()) / 3;
+        if (spokes) {
+          buildSpokes(params, i, j, (*spokes)[chunk]);
+          vertices += (*spokes)[chunk].positions.size() / 3;
+        }
+      }
+    }
+    return vertices;
+  }
+
+  // Arguments: circles count, sector count (0 disables sectors) and the
+  // angular span of the sectors in degrees.
+  PolarGridParams makeParams(const benchmark::State & state)
+  {
+    PolarGridParams params;
+    params.circles_count = static_cast < int > (state.range(0));
+    params.sectors = state.range(1) > 0;
+    params.sector_count = std::max(1, static_cast < int > (state.range(1)));
+    params.min_angle = -0.5f * state.range(2);
+    params.max_angle = 0.5f * state.range(2);
+    params.major_every = 5;
+    return params;
+  }
+
+  void BM_BuildGrid(benchmark::State & state)
+  {
+    PolarGridParams params = makeParams(state);
+    std::vector < PolarGridGeometry > bands, spokes;
+    size_t vertices = 0;
+    for (auto _ : state) {
+      vertices = buildBands(params, bands, &spokes);
+      benchmark::DoNotOptimize(bands.data());
+      benchmark::ClobberMemory();
+    }
+    state.counters["vertices"] = static_cast < double > (vertices);
+    state.counters["vertices/s"] = benchmark::Counter(
+      static_cast < double > (vertices), benchmark::Counter::kIsIterationInvariantRate);
+  }
+  BENCHMARK(BM_BuildGrid)
+  ->ArgNames({"circles", "sectors", "span"})
+  ->ArgsProduct({{5, 50, 400, 2000}, {0, 8, 36}, {360, 90}});
+
+  // Tessellation matters as much as the circle count, so also cover coarse
+  // and fine adaptive levels.
+  void BM_BuildGridLevels(benchmark::State & state)
+  {
+    PolarGridParams params;
+    params.circles_count = static_cast < int > (state.range(0));
+    params.ring_levels.assign(params.circles_count, static_cast < int > (state.range(1)));
+    std::vector < PolarGridGeometry > bands;
+    size_t vertices = 0;
+    for (auto _ : state) {
+      vertices = buildBands(params, bands);
+      benchmark::DoNotOptimize(bands.data());
+      benchmark::ClobberMemory();
+    }
+    state.counters["vertices/s"] = benchmark::Counter(
+      static_cast < double > (vertices), benchmark::Counter::kIsIterationInvariantRate);
+  }
+  BENCHMARK(BM_BuildGridLevels)
+  ->ArgNames({"circles", "level"})
+  ->ArgsProduct({{50, 400}, {4, 8, 12}});
+
+  void BM_ScaleUnitCircle(benchmark::State & state)
+  {
+    int segments = static_cast < int > (state.range(0));
+    auto circle = getUnitCircle(0.f, 360.f, segments);
+    std::vector < float > out(3 * (segments + 1));
+    for (auto _ : state) {
+      scaleUnitCircle(*circle, 2.f, out.data());
+      benchmark::DoNotOptimize(out.data());
+      benchmark::ClobberMemory();
+    }
+    state.counters["vertices/s"] = benchmark::Counter(
+      segments + 1, benchmark::Counter::kIsIterationInvariantRate);
+  }
+  BENCHMARK(BM_ScaleUnitCircle)->RangeMultiplier(8)->Range(64, 8192);
+
+  }  // namespace
+
+}  // namespace polar_grid_rviz_plugins
+
+BENCHMARK_MAIN();
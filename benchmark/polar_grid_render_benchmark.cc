@@ -0,0 +1,364 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <OgreCamera.h>
+#include <OgreHardwarePixelBuffer.h>
+#include <OgreRenderTexture.h>
+#include <OgreRoot.h>
+#include <OgreSceneManager.h>
+#include <OgreTextureManager.h>
+#include <OgreViewport.h>
+
+#include <polar_grid_rviz_plugins/polar_grid.hpp>
+#include <rviz_rendering/render_system.hpp>
+
+// Frame-time regression harness for PolarGrid. Renders grids into an
+// offscreen target, so it runs under Xvfb with a software GL such as Mesa
+// llvmpipe on machines without a GPU:
+//
+//   xvfb-run -a ./polar_grid_render_benchmark
+//
+// Results go to POLAR_GRID_RENDER_RESULTS, polar_grid_render_results.csv by
+// default, as case,metric,value lines and are also recorded as gtest
+// properties. If POLAR_GRID_RENDER_BASELINE names the results of an earlier
+// run, a metric more than POLAR_GRID_RENDER_TOLERANCE, 0.25 by default, over
+// its baseline fails the case.
+
+namespace polar_grid_rviz_plugins {
+
+  namespace {
+
+  constexpr int kTargetWidth = 1280;
+  constexpr int kTargetHeight = 720;
+  constexpr int kRebuilds = 10;
+  constexpr int kWarmupFrames = 5;
+  constexpr int kFrames = 60;
+  // Regressions of less than this many microseconds are noise.
+  constexpr double kMinRegression = 50.0;
+
+  using Clock = std::chrono::steady_clock;
+
+  double elapsed(Clock::time_point start)
+  {
+    return std::chrono::duration < double, std::micro > (Clock::now() - start).count();
+  }
+
+  const char * getEnv(const char * name, const char * fallback)
+  {
+    const char * value = std::getenv(name);
+    return value && *value ? value : fallback;
+  }
+
+  enum class Sectors
+  {
+    kNone,
+    // 8 sectors over the full circle.
+    kFull,
+    // 64 sectors over 120 degrees.
+    kNarrow,
+  };
+
+  // Circles count, sectors, grid count and whether the grids share geometry.
+  using Case = std::tuple < int, Sectors, int, bool >;
+
+  std::string caseName(const Case & c)
+  {
+    static const char * kSectorNames[] = {"none", "full", "narrow"};
+    std::ostringstream name;
+    name << "circles" << std::get < 0 > (c) << "_sectors" <<
+      kSectorNames[static_cast < int > (std::get < 1 > (c))] << "_grids" << std::get < 2 > (c) <<
+      (std::get < 3 > (c) ? "_shared" : "_private");
+    return name.str();
+  }
+
+  // Ogre scene with an offscreen target shared by every case, results of
+  // all cases and the baseline they are compared against.
+  class RenderEnvironment : public ::testing::Environment
+  {
+public:
+    void SetUp() override
+    {
+      if (!std::getenv("DISPLAY")) {
+        return;
+      }
+      rviz_rendering::RenderSystem * render_system = rviz_rendering::RenderSystem::get();
+      root_ = render_system->getOgreRoot();
+      scene_manager_ = root_->createSceneManager();
+
+      texture_ = Ogre::TextureManager::getSingleton().createManual(
+        "PolarGridBenchmarkTarget", "rviz_rendering", Ogre::TEX_TYPE_2D, kTargetWidth,
+        kTargetHeight, 0, Ogre::PF_R8G8B8A8, Ogre::TU_RENDERTARGET);
+      target_ = texture_->getBuffer()->getRenderTarget();
+      target_->setAutoUpdated(false);
+
+      camera_ = scene_manager_->createCamera("PolarGridBenchmarkCamera");
+      camera_->setNearClipDistance(0.1f);
+      camera_->setAutoAspectRatio(true);
+      camera_node_ = scene_manager_->getRootSceneNode()->createChildSceneNode();
+      camera_node_->attachObject(camera_);
+      Ogre::Viewport * viewport = target_->addViewport(camera_);
+      viewport->setBackgroundColour(Ogre::ColourValue::Black);
+      viewport->setOverlaysEnabled(false);
+
+      loadBaseline();
+    }
+
+    void TearDown() override
+    {
+      std::ofstream out(getEnv("POLAR_GRID_RENDER_RESULTS", "polar_grid_render_results.csv"));
+      out << "case,metric,value\n";
+      for (const auto & [key, value] : results_) {
+        out << key.first << "," << key.second << "," << value << "\n";
+      }
+      if (root_) {
+        target_->removeAllViewports();
+        Ogre::TextureManager::getSingleton().remove(texture_);
+        root_->destroySceneManager(scene_manager_);
+      }
+    }
+
+    bool isAvailable() const {return root_ != nullptr;}
+    Ogre::SceneManager * getSceneManager() const {return scene_manager_;}
+    Ogre::Camera * getCamera() const {return camera_;}
+
+    // Looks at a square area from above at an angle, like a typical rviz
+    // view.
+    void frame(const Ogre::Vector3 & center, float size)
+    {
+      camera_node_->setPosition(center + Ogre::Vector3(0.f, -0.5f * size, size));
+      camera_node_->lookAt(center, Ogre::Node::TS_WORLD);
+    }
+
+    // Renders one frame and waits for the GPU by reading a pixel back.
+    void render()
+    {
+      target_->update();
+      uint32_t pixel = 0;
+      texture_->getBuffer()->blitToMemory(
+        Ogre::Box(0, 0, 1, 1), Ogre::PixelBox(1, 1, 1, Ogre::PF_R8G8B8A8, &pixel));
+    }
+
+    void report(const std::string & name, const std::string & metric, double value)
+    {
+      results_[{name, metric}] = value;
+      ::testing::Test::RecordProperty(metric, std::to_string(value));
+      auto it = baseline_.find({name, metric});
+      if (it == baseline_.end()) {return;}
+      double limit = it->second * (1.0 + tolerance_);
+      EXPECT_FALSE(value > limit && value - it->second > kMinRegression) <<
+        metric << " regressed from " << it->second << " to " << value;
+    }
+
+private:
+    void loadBaseline()
+    {
+      tolerance_ = std::atof(getEnv("POLAR_GRID_RENDER_TOLERANCE", "0.25"));
+      const char * path = std::getenv("POLAR_GRID_RENDER_BASELINE");
+      if (!path) {return;}
+      std::ifstream in(path);
+      std::string line;
+      std::getline(in, line);
+      while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string name, metric, value;
+        if (std::getline(fields, name, ',') && std::getline(fields, metric, ',') &&
+          std::getline(fields, value))
+        {
+          baseline_[{name, metric}] = std::atof(value.c_str());
+        }
+      }
+    }
+
+    Ogre::Root * root_ = nullptr;
+    Ogre::SceneManager * scene_manager_ = nullptr;
+    Ogre::TexturePtr texture_;
+    Ogre::RenderTarget * target_ = nullptr;
+    Ogre::Camera * camera_ = nullptr;
+    Ogre::SceneNode * camera_node_ = nullptr;
+    double tolerance_ = 0.25;
+    std::map < std::pair < std::string, std::string >, double > results_;
+    std::map < std::pair < std::string, std::string >, double > baseline_;
+  };
+
+  RenderEnvironment * environment = nullptr;
+
+  class PolarGridRenderBenchmark : public ::testing::TestWithParam < Case >
+  {
+protected:
+    void SetUp() override
+    {
+      if (!environment->isAvailable()) {
+        GTEST_SKIP() << "No DISPLAY, run under xvfb-run.";
+      }
+      std::tie(circles_count_, sectors_, grid_count_, shared_) = GetParam();
+      name_ = caseName(GetParam());
+    }
+
+    void TearDown() override {grids_.clear();}
+
+    // Drives the grids like PolarGridDisplay::update() until every rebuild,
+    // including background ones, is uploaded.
+    void updateUntilBuilt()
+    {
+      while (true) {
+        bool done = true;
+        for (auto & grid : grids_) {
+          grid->setCamera(environment->getCamera());
+          grid->update();
+          done &= !grid->isBuilding() && !grid->isDirty();
+        }
+        if (done) {
+          return;
+        }
+        std::this_thread::yield();
+      }
+    }
+
+    void createGrids()
+    {
+      // Lay the grids out on a square lattice, far enough apart not to
+      // overlap.
+      float spacing = 2.2f * circles_count_;
+      int columns = 1;
+      while (columns * columns < grid_count_) {
+        ++columns;
+      }
+      float span = spacing * (columns - 1);
+      environment->frame(
+        Ogre::Vector3(0.5f * span, 0.5f * span, 0.f), span + 2.f * circles_count_);
+
+      for (int i = 0; i < grid_count_; ++i) {
+        auto grid = std::make_unique < PolarGrid > (environment->getSceneManager(), nullptr);
+        grid->setShareGeometry(shared_);
+        grid->setColor(0.6f, 0.6f, 0.64f, 0.5f);
+        grid->setRadiusStep(1.f);
+        grid->setCirclesCount(circles_count_);
+        grid->setMajorEvery(5);
+        grid->setPixelTolerance(0.5f);
+        grid->setLodPixelSpacing(3.f);
+        if (sectors_ != Sectors::kNone) {
+          grid->setSectors(true);
+          grid->setSectorCount(sectors_ == Sectors::kFull ? 8 : 64);
+          grid->setMinAngle(sectors_ == Sectors::kFull ? -180 : -60);
+          grid->setMaxAngle(sectors_ == Sectors::kFull ? 180 : 60);
+        }
+        grid->setPosition(Ogre::Vector3(spacing * (i % columns), spacing * (i / columns), 0.f));
+        grids_.push_back(std::move(grid));
+      }
+    }
+
+    std::string name_;
+    int circles_count_ = 0;
+    Sectors sectors_ = Sectors::kNone;
+    int grid_count_ = 0;
+    bool shared_ = false;
+    std::vector < std::unique_ptr < PolarGrid >> grids_;
+  };
+
+  TEST_P(PolarGridRenderBenchmark, FrameTime)
+  {
+    auto start = Clock::now();
+    createGrids();
+    updateUntilBuilt();
+    environment->report(name_, "init_us", elapsed(start));
+
+    start = Clock::now();
+    environment->render();
+    environment->report(name_, "first_frame_us", elapsed(start));
+
+    // Moving the first circle rebuilds every circle and spoke.
+    double rebuild_time = 0.0;
+    for (int i = 0; i < kRebuilds; ++i) {
+      start = Clock::now();
+      for (auto & grid : grids_) {
+        grid->setMinRadius(i % 2 ? 0.f : 0.5f);
+      }
+      updateUntilBuilt();
+      rebuild_time += elapsed(start);
+      environment->render();
+    }
+    environment->report(name_, "rebuild_us", rebuild_time / kRebuilds);
+
+    for (int i = 0; i < kWarmupFrames; ++i) {
+      updateUntilBuilt();
+      environment->render();
+    }
+    std::vector < double > frames;
+    for (int i = 0; i < kFrames; ++i) {
+      start = Clock::now();
+      updateUntilBuilt();
+      environment->render();
+      frames.push_back(elapsed(start));
+    }
+    std::sort(frames.begin(), frames.end());
+    double total = 0.0;
+    for (double frame : frames) {
+      total += frame;
+    }
+    environment->report(name_, "frame_mean_us", total / kFrames);
+    environment->report(name_, "frame_p95_us", frames[kFrames * 95 / 100]);
+
+    size_t vertices = 0;
+    for (auto & grid : grids_) {
+      vertices += grid->getVertexCount();
+    }
+    ::testing::Test::RecordProperty("vertices", std::to_string(vertices));
+  }
+
+  INSTANTIATE_TEST_SUITE_P(
+    Matrix, PolarGridRenderBenchmark,
+    ::testing::Combine(
+      ::testing::Values(16, 256, 2048),
+      ::testing::Values(Sectors::kNone, Sectors::kFull, Sectors::kNarrow),
+      ::testing::Values(1, 8),
+      ::testing::Bool()),
+    [](const ::testing::TestParamInfo < Case > & info) {return caseName(info.param);});
+
+  }  // namespace
+
+}  // namespace polar_grid_rviz_plugins
+
+int main(int argc, char ** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  // Owned and deleted by gtest.
+  polar_grid_rviz_plugins::environment = new polar_grid_rviz_plugins::RenderEnvironment;
+  ::testing::AddGlobalTestEnvironment(polar_grid_rviz_plugins::environment);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,59 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace polar_grid_rviz_plugins
+{
+
+// Single-slot mailbox handing the most recent value from one thread to
+// another. Both store() and take() are wait-free, a value that is stored
+// before the previous one was taken replaces it.
+template<typename T>
+class LatestValue
+{
+public:
+  LatestValue() = default;
+  LatestValue(const LatestValue &) = delete;
+  LatestValue & operator=(const LatestValue &) = delete;
+  ~LatestValue() {delete slot_.exchange(nullptr);}
+
+  void store(std::unique_ptr<T> value)
+  {
+    delete slot_.exchange(value.release(), std::memory_order_acq_rel);
+  }
+
+  // Returns nullptr if nothing was stored since the last take().
+  std::unique_ptr<T> take()
+  {
+    return std::unique_ptr<T>(slot_.exchange(nullptr, std::memory_order_acq_rel));
+  }
+
+private:
+  std::atomic<T *> slot_{nullptr};
+};
+
+}  // namespace polar_grid_rviz_plugins
@@ -0,0 +1,91 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <polar_grid_rviz_plugins/polar_grid_batch.hpp>
+#include <rviz_common/config.hpp>
+#include <rviz_common/display.hpp>
+#include <rviz_common/properties/bool_property.hpp>
+#include <rviz_common/properties/color_property.hpp>
+#include <rviz_common/properties/float_property.hpp>
+#include <rviz_common/properties/int_property.hpp>
+#include <rviz_common/properties/tf_frame_property.hpp>
+#include <rviz_common/properties/vector_property.hpp>
+
+namespace polar_grid_rviz_plugins
+{
+
+// Polar grids around many frames, e.g. every radar and lidar of a vehicle,
+// drawn as a single batch relative to a reference frame the sensors are
+// rigidly attached to. All transforms are looked up in one pass per update
+// and the batch is only rebuilt when a grid moves relative to the reference
+// frame or changes.
+class MultiPolarGridDisplay : public rviz_common::Display
+{
+  Q_OBJECT
+
+public:
+  MultiPolarGridDisplay();
+  void onInitialize() override;
+  void update(float dt, float ros_dt) override;
+  // Creates the grid properties before loading their values.
+  void load(const rviz_common::Config & config) override;
+
+private Q_SLOTS:
+  void updateColor();
+  void updateGridCount();
+  void updateGrids();
+
+private:
+  // Properties of one grid, the children are owned by group.
+  struct GridProperties
+  {
+    std::unique_ptr<rviz_common::properties::Property> group;
+    rviz_common::properties::TfFrameProperty * frame;
+    rviz_common::properties::VectorProperty * offset;
+    rviz_common::properties::FloatProperty * min_radius;
+    rviz_common::properties::FloatProperty * radius_step;
+    rviz_common::properties::IntProperty * circles_count;
+    rviz_common::properties::BoolProperty * sectors;
+    rviz_common::properties::IntProperty * min_angle;
+    rviz_common::properties::IntProperty * max_angle;
+    rviz_common::properties::IntProperty * sector_count;
+    rviz_common::properties::BoolProperty * invert;
+  };
+
+  GridProperties createGrid(int index);
+
+protected:
+  std::unique_ptr<PolarGridBatch> batch_;
+  std::unique_ptr<rviz_common::properties::TfFrameProperty> frame_property_;
+  std::unique_ptr<rviz_common::properties::ColorProperty> color_property_;
+  std::unique_ptr<rviz_common::properties::FloatProperty> alpha_property_;
+  std::unique_ptr<rviz_common::properties::IntProperty> grid_count_property_;
+  std::vector<GridProperties> grids_;
+};
+
+}  // namespace polar_grid_rviz_plugins
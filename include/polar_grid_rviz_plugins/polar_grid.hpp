@@ -23,21 +23,105 @@
  */
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <OgreCamera.h>
+#include <OgreEntity.h>
+#include <OgreManualObject.h>
 #include <OgreMaterial.h>
 #include <OgreSceneManager.h>
 #include <OgreSceneNode.h>
 
+#include <polar_grid_rviz_plugins/latest_value.hpp>
+#include <polar_grid_rviz_plugins/polar_grid_cache.hpp>
+#include <polar_grid_rviz_plugins/polar_grid_geometry.hpp>
+#include <polar_grid_rviz_plugins/polar_grid_labels.hpp>
+#include <polar_grid_rviz_plugins/shader_quad.hpp>
 #include <rviz_rendering/objects/object.hpp>
 
 namespace polar_grid_rviz_plugins
 {
 
+// Chunks to regenerate for one rebuild.
+struct PolarGridJob
+{
+  uint64_t generation = 0;
+  PolarGridParams params;
+  std::vector<int> bands;
+  bool spokes = false;
+  // Skip the chunks whose shared mesh is already uploaded.
+  bool shared = false;
+};
+
+// Chunks regenerated by one rebuild.
+struct PolarGridBuild
+{
+  uint64_t generation = 0;
+  std::vector<PolarGridGeometry> chunks;
+  // Time spent generating the chunks in microseconds.
+  double build_time = 0.0;
+};
+
+// Work a grid did since it was created. Only the render thread writes these,
+// background builds report their time along with their chunks, so they are
+// plain counters cheap enough to keep on.
+struct PolarGridStats
+{
+  uint64_t rebuilds = 0;
+  // Generation and upload time of the rebuilds in microseconds.
+  double rebuild_time = 0.0;
+  double last_rebuild_time = 0.0;
+  // Bytes of vertices and indices handed to Ogre.
+  uint64_t uploaded_bytes = 0;
+};
+
 class PolarGrid : public rviz_rendering::Object
 {
 public:
+  // Parameters changed since the last rebuild. Single bands of circles, see
+  // bandCircles(), are tracked in dirty_bands_.
+  enum DirtyFlags : uint32_t
+  {
+    kDirtyNone = 0,
+    kDirtyRings = 1 << 0,
+    kDirtySectors = 1 << 1,
+    kDirtyAll = kDirtyRings | kDirtySectors,
+  };
+
+  enum class RenderMode
+  {
+    // Line geometry regenerated on the CPU.
+    kLines,
+    // A single quad whose fragment program draws the grid from uniforms.
+    kProcedural,
+  };
+
   explicit PolarGrid(Ogre::SceneManager * scene_manager, Ogre::SceneNode * parent_node);
+  ~PolarGrid() override;
 
-  void draw();
+  // Rebuilds the dirty chunks, or every chunk if all is true. Small rebuilds
+  // are generated and uploaded right away, large ones on a worker thread and
+  // uploaded by a later update(). Returns true if the new geometry is already
+  // uploaded.
+  bool draw(bool all = true);
+  // Uploads finished background builds and rebuilds the chunks a setter
+  // changed since the last rebuild. Hidden grids keep their changes until
+  // they are shown. Returns true if the geometry shown changed.
+  bool update();
+  // Frees the line buffers, the staged geometry, the procedural quad and the
+  // labels, the next update() of a visible grid builds them again. The
+  // materials of the grid hold no buffers and its colour, so they are kept.
+  void releaseGeometry();
+  bool isDirty() const;
+  // True while a background build is in flight.
+  bool isBuilding() const;
 
   void setPosition(const Ogre::Vector3 & position) override;
   void setOrientation(const Ogre::Quaternion & orientation) override;
@@ -55,22 +139,143 @@ public:
   void setMaxAngle(int max_angle);
   void setSectorCount(int sector_count);
   void setInvert(bool invert);
+  // Every major_every-th radius step is a major circle, all circles are major
+  // if 1 or less.
+  void setMajorEvery(int major_every);
+  // Minimum on-screen spacing of the circles of a tier in pixels, below
+  // twice that the tier fades out and below it the tier is hidden. Zero or
+  // less always shows every circle.
+  void setLodPixelSpacing(float lod_pixel_spacing);
+  // Maximum chord error of the circles in pixels. Zero or less disables the
+  // adaptive tessellation and falls back to fixed 1 degree segments.
+  void setPixelTolerance(float pixel_tolerance);
+  // Fades the circle tiers, picks the number of segments of each circle and
+  // culls the labels for the given camera. Only marks the circles dirty if
+  // some circle needs to be re-tessellated.
+  void setCamera(const Ogre::Camera * camera);
+  // Range and bearing labels, off by default. Returns false if the font or
+  // the label material is not available.
+  bool setLabels(bool labels);
+  void setLabelColor(float r, float g, float b, float a);
+  // Height of the label characters in meters.
+  void setLabelSize(float label_size);
+  // Takes the line chunks from meshes and materials shared with every grid
+  // that has identical chunks, instead of private dynamic buffers. Off by
+  // default.
+  void setShareGeometry(bool share_geometry);
+  // Falls back to kLines if the procedural material is not available.
+  void setRenderMode(RenderMode render_mode);
+  RenderMode getRenderMode() const;
+  const PolarGridParams & getParams() const;
+
+  // Size of the geometry uploaded by the last rebuild.
+  size_t getVertexCount() const;
+  size_t getIndexCount() const;
+  size_t getVertexBufferSize() const;
+  size_t getIndexBufferSize() const;
+  // Chunks with geometry, each drawn in its own batch.
+  size_t getBatchCount() const;
+  const PolarGridStats & getStats() const;
+
+  // Use this rather than the scene node, which also holds hidden chunks.
+  void setVisible(bool visible);
+  // Hides the chunks, the quad and the labels the grid does not show again,
+  // e.g. after the parent node was shown recursively.
+  void applyVisibility();
 
   std::shared_ptr<Ogre::SceneNode> getSceneNode();
 
 private:
-  Ogre::MaterialPtr material_;
+  // Dynamic line buffers of one chunk, sized to a high-water mark, or an
+  // entity of a shared mesh if the grid shares its geometry.
+  struct LineChunk
+  {
+    // nullptr if the chunk has nothing to draw yet.
+    Ogre::MovableObject * movable() const;
+    void setMaterial(const Ogre::MaterialPtr & material);
+
+    std::shared_ptr<Ogre::ManualObject> object;
+    size_t vertex_capacity = 0;
+    size_t index_capacity = 0;
+    std::shared_ptr<const SharedMesh> mesh;
+    std::shared_ptr<Ogre::Entity> entity;
+  };
+
+  bool createProcedural();
+  void updateProcedural();
+  LineChunk createChunk(const std::string & name, Ogre::SceneNode * node);
+  // Node of one slice of a band, created on first use.
+  Ogre::SceneNode * sliceNode(int band, int slice);
+  void markRings(int first, int last);
+  void upload(const PolarGridBuild & build);
+  void updateLevelOfDetail(const Ogre::Camera * camera);
+  void upload(
+    const PolarGridGeometry & geometry, LineChunk & chunk, const Ogre::MaterialPtr & material);
+  void share(
+    const PolarGridGeometry & geometry, LineChunk & chunk, const Ogre::MaterialPtr & material,
+    Ogre::SceneNode * node);
+  void setTierFade(RingTier tier, float fade);
+  void applyColor();
+  void updateBufferSizes();
+  void work();
+
+  std::string name_;
+  // Private materials of the major and minor circles, so that they fade
+  // independently.
+  Ogre::MaterialPtr own_materials_[2];
+  // Material of the color of the grid while it shares its geometry.
+  std::shared_ptr<const SharedMaterial> shared_material_;
+  Ogre::ColourValue shared_color_;
+  // Materials the chunks of the major and minor circles are drawn with.
+  Ogre::MaterialPtr tier_materials_[2];
   std::shared_ptr<Ogre::SceneNode> scene_node_;
-  std::shared_ptr<Ogre::ManualObject> polar_grid_;
+  // Ogre culls whole scene nodes, so the chunks of each slice of a band hang
+  // off their own child node, indexed by band then slice.
+  std::vector<std::vector<std::shared_ptr<Ogre::SceneNode>>> slice_nodes_;
+  // Slices of the bands of the major and minor circles and of the spokes,
+  // indexed by band then slice.
+  std::vector<std::vector<LineChunk>> bands_[2];
+  std::vector<std::vector<LineChunk>> spokes_;
+  std::unique_ptr<ShaderQuad> quad_;
+  bool visible_;
   Ogre::ColourValue color_;
-  float min_radius_;
-  float radius_step_;
-  int circles_count_;
-  bool sectors_;
-  float min_angle_;
-  float max_angle_;
-  int sector_count_;
-  bool invert_;
+  PolarGridParams params_;
+  float pixel_tolerance_;
+  float lod_pixel_spacing_;
+  // Alpha factor of the major and minor circles, hidden at 0.
+  float tier_fade_[2];
+  std::unique_ptr<PolarGridLabels> labels_;
+  // Labels are on, even while released.
+  bool labels_enabled_;
+  Ogre::ColourValue label_color_;
+  float label_size_;
+  RenderMode render_mode_;
+  bool share_geometry_;
+  size_t vertex_count_;
+  size_t index_count_;
+  size_t vertex_buffer_size_;
+  size_t index_buffer_size_;
+  size_t batch_count_;
+  uint32_t dirty_;
+  std::vector<bool> dirty_bands_;
+  PolarGridStats stats_;
+
+  // Small rebuilds are generated in place on the render thread.
+  PolarGridBuild staging_;
+  // Background builds. Every rebuild bumps generation_, builds of an older
+  // generation are abandoned by the worker or dropped by update(). Chunks of
+  // abandoned builds stay pending and are folded into the next rebuild.
+  std::atomic<uint64_t> generation_;
+  uint64_t uploaded_generation_;
+  std::vector<bool> pending_bands_;
+  bool pending_spokes_;
+  std::thread worker_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::unique_ptr<PolarGridJob> job_;
+  bool stop_;
+  LatestValue<PolarGridBuild> ready_;
+  LatestValue<PolarGridBuild> spare_;
 };
 
 }  // namespace polar_grid_rviz_plugins
@@ -0,0 +1,95 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <OgreManualObject.h>
+#include <OgreMaterial.h>
+#include <OgreSceneManager.h>
+#include <OgreSceneNode.h>
+
+#include <polar_grid_rviz_plugins/polar_grid_geometry.hpp>
+
+namespace polar_grid_rviz_plugins
+{
+
+// Many polar grids, each with its own parameters and pose relative to a
+// shared scene node, baked into a single line list with one material. Poses
+// are expected to be mostly static relative to the node, e.g. sensors on a
+// vehicle, so the batch is only rebuilt when a grid moves or changes.
+class PolarGridBatch
+{
+public:
+  PolarGridBatch(Ogre::SceneManager * scene_manager, Ogre::SceneNode * parent_node);
+  // Frees the line list, the scene node and the material.
+  ~PolarGridBatch();
+
+  void setColor(float r, float g, float b, float a);
+  void setVisible(bool visible);
+
+  void resize(size_t count);
+  size_t size() const;
+  void setParams(size_t grid, const PolarGridParams & params);
+  // Pose of a grid relative to the scene node. Changes below a tenth of a
+  // millimeter or milliradian are ignored, so that the noise of relative
+  // poses derived from two transforms does not trigger rebuilds.
+  void setPose(size_t grid, const Ogre::Vector3 & position, const Ogre::Quaternion & orientation);
+  // Grids without a pose, e.g. for lack of a transform, are left out.
+  void setGridVisible(size_t grid, bool visible);
+
+  // Rebuilds the batch if a grid changed. Returns true if it did.
+  bool update();
+  size_t getVertexCount() const;
+
+  std::shared_ptr<Ogre::SceneNode> getSceneNode();
+
+private:
+  struct Grid
+  {
+    PolarGridParams params;
+    Ogre::Vector3 position = Ogre::Vector3::ZERO;
+    Ogre::Quaternion orientation = Ogre::Quaternion::IDENTITY;
+    bool visible = false;
+  };
+
+  void append(const Grid & grid, const PolarGridGeometry & geometry, uint32_t base);
+
+  Ogre::SceneManager * scene_manager_;
+  std::shared_ptr<Ogre::SceneNode> scene_node_;
+  std::shared_ptr<Ogre::ManualObject> object_;
+  Ogre::MaterialPtr material_;
+  std::vector<Grid> grids_;
+  bool dirty_;
+  size_t vertex_capacity_;
+  size_t index_capacity_;
+  size_t vertex_count_;
+  // Scratch chunk reused across grids and rebuilds.
+  PolarGridGeometry geometry_;
+  Ogre::AxisAlignedBox bounds_;
+};
+
+}  // namespace polar_grid_rviz_plugins
@@ -0,0 +1,69 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <OgreColourValue.h>
+#include <OgreMaterial.h>
+#include <OgreMesh.h>
+
+#include <polar_grid_rviz_plugins/polar_grid_geometry.hpp>
+
+namespace polar_grid_rviz_plugins
+{
+
+// Static line mesh of one chunk, shared by the chunks of every grid with the
+// same chunk key.
+struct SharedMesh
+{
+  Ogre::MeshPtr mesh;
+  size_t vertex_count = 0;
+  size_t index_count = 0;
+  size_t vertex_buffer_size = 0;
+  size_t index_buffer_size = 0;
+};
+
+// Emissive line material of one colour, shared by every grid of that colour.
+struct SharedMaterial
+{
+  Ogre::MaterialPtr material;
+};
+
+// Returns the mesh of geometry.key, uploading geometry if no grid holds one
+// yet. Returns nullptr if geometry was skipped as cached and the mesh has
+// been released since. Meshes are removed once their last holder lets go.
+// Render thread only.
+std::shared_ptr<const SharedMesh> acquireMesh(const PolarGridGeometry & geometry);
+
+// True if some grid holds the mesh of key. Safe to call from any thread.
+bool isMeshCached(const std::string & key);
+
+// Returns the material of color, compared at 8 bits per channel, creating it
+// if no grid holds one yet. Render thread only.
+std::shared_ptr<const SharedMaterial> acquireMaterial(const Ogre::ColourValue & color);
+
+}  // namespace polar_grid_rviz_plugins
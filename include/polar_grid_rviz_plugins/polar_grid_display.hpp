@@ -23,14 +23,30 @@
  */
 #pragma once
 
+#include <chrono>
+#include <optional>
+#include <string>
+
+#include <QTimer>
+
+#include <diagnostic_msgs/msg/diagnostic_array.hpp>
+#include <polar_grid_rviz_plugins/latest_value.hpp>
 #include <polar_grid_rviz_plugins/polar_grid.hpp>
+#include <polar_grid_rviz_plugins/polar_heatmap.hpp>
+#include <polar_grid_rviz_plugins/polar_sweep.hpp>
+#include <rclcpp/publisher.hpp>
+#include <rclcpp/subscription.hpp>
 #include <rviz_common/display.hpp>
 #include <rviz_common/properties/color_property.hpp>
 #include <rviz_common/properties/enum_property.hpp>
 #include <rviz_common/properties/float_property.hpp>
 #include <rviz_common/properties/int_property.hpp>
+#include <rviz_common/properties/ros_topic_property.hpp>
 #include <rviz_common/properties/tf_frame_property.hpp>
 #include <rviz_common/properties/vector_property.hpp>
+#include <sensor_msgs/msg/image.hpp>
+#include <std_msgs/msg/float32.hpp>
+#include <std_msgs/msg/float32_multi_array.hpp>
 
 namespace polar_grid_rviz_plugins
 {
@@ -49,12 +65,22 @@ public:
   PolarGridDisplay();
   void onInitialize() override;
   void update(float dt, float ros_dt) override;
+  void reset() override;
+  // Average time spent in update() in microseconds.
+  double getUpdateTime() const;
+
+protected:
+  void onEnable() override;
+  void onDisable() override;
+  void fixedFrameChanged() override;
 
 private Q_SLOTS:
+  void updateReferenceFrame();
   void updateColor();
   void updateMinRadius();
   void updateRadiusStep();
   void updateCirclesCount();
+  void updateMajorEvery();
   void updatePlane();
   void updateSectors();
   void updateMinAngle();
@@ -62,6 +88,22 @@ private Q_SLOTS:
   void updateSectorCount();
   void updateInvert();
   void updateOffset();
+  void updatePixelTolerance();
+  void updateLodPixelSpacing();
+  void updateRenderMode();
+  void updateShareGeometry();
+  void updateLabels();
+  void updateLabelColor();
+  void updateLabelSize();
+  void updateParameterTopic();
+  void updateMetricsTopic();
+  void updateHeatmap();
+  void updateHeatmapTopic();
+  void updateHeatmapStyle();
+  void updateSweep();
+  void updateSweepTopic();
+  void updateSweepStyle();
+  void releaseResources();
 
 protected:
   std::unique_ptr<PolarGrid> polar_grid_;
@@ -71,6 +113,7 @@ protected:
   std::unique_ptr<rviz_common::properties::FloatProperty> min_radius_property_;
   std::unique_ptr<rviz_common::properties::FloatProperty> radius_step_property_;
   std::unique_ptr<rviz_common::properties::IntProperty> circles_count_property_;
+  std::unique_ptr<rviz_common::properties::IntProperty> major_every_property_;
   std::unique_ptr<rviz_common::properties::EnumProperty> plane_property_;
   std::unique_ptr<rviz_common::properties::BoolProperty> sectors_property_;
   std::unique_ptr<rviz_common::properties::IntProperty> min_angle_property_;
@@ -78,6 +121,97 @@ protected:
   std::unique_ptr<rviz_common::properties::IntProperty> sector_count_property_;
   std::unique_ptr<rviz_common::properties::BoolProperty> invert_property_;
   std::unique_ptr<rviz_common::properties::VectorProperty> offset_property_;
+  std::unique_ptr<rviz_common::properties::FloatProperty> pixel_tolerance_property_;
+  std::unique_ptr<rviz_common::properties::FloatProperty> lod_pixel_spacing_property_;
+  std::unique_ptr<rviz_common::properties::EnumProperty> render_mode_property_;
+  std::unique_ptr<rviz_common::properties::BoolProperty> share_geometry_property_;
+  std::unique_ptr<rviz_common::properties::FloatProperty> release_time_property_;
+  std::unique_ptr<rviz_common::properties::BoolProperty> labels_property_;
+  std::unique_ptr<rviz_common::properties::ColorProperty> label_color_property_;
+  std::unique_ptr<rviz_common::properties::FloatProperty> label_size_property_;
+  std::unique_ptr<rviz_common::properties::RosTopicProperty> parameter_topic_property_;
+  std::unique_ptr<rviz_common::properties::FloatProperty> change_threshold_property_;
+  std::unique_ptr<rviz_common::properties::RosTopicProperty> metrics_topic_property_;
+  std::unique_ptr<PolarHeatmap> heatmap_;
+  std::unique_ptr<rviz_common::properties::BoolProperty> heatmap_property_;
+  std::unique_ptr<rviz_common::properties::RosTopicProperty> heatmap_topic_property_;
+  std::unique_ptr<rviz_common::properties::FloatProperty> heatmap_min_value_property_;
+  std::unique_ptr<rviz_common::properties::FloatProperty> heatmap_max_value_property_;
+  std::unique_ptr<rviz_common::properties::EnumProperty> heatmap_color_map_property_;
+  std::unique_ptr<rviz_common::properties::FloatProperty> heatmap_alpha_property_;
+  std::unique_ptr<PolarSweep> sweep_;
+  std::unique_ptr<rviz_common::properties::BoolProperty> sweep_property_;
+  std::unique_ptr<rviz_common::properties::ColorProperty> sweep_color_property_;
+  std::unique_ptr<rviz_common::properties::FloatProperty> sweep_alpha_property_;
+  std::unique_ptr<rviz_common::properties::FloatProperty> sweep_rate_property_;
+  std::unique_ptr<rviz_common::properties::FloatProperty> sweep_trail_property_;
+  std::unique_ptr<rviz_common::properties::RosTopicProperty> sweep_topic_property_;
+
+private:
+  // Grid parameters published on the parameter topic.
+  struct LiveParams
+  {
+    float min_radius;
+    float radius_step;
+    int circles_count;
+    float min_angle;
+    float max_angle;
+  };
+
+  void subscribe();
+  void unsubscribe();
+  void subscribeHeatmap();
+  void unsubscribeHeatmap();
+  // Uploads the latest heatmap array, if any arrived since the last update.
+  void uploadHeatmap();
+  // Destroys the heatmap and checks that its texture left the GPU with it.
+  void releaseHeatmap();
+  void subscribeSweep();
+  void unsubscribeSweep();
+  // Turns the sweep by the rate or to the latest azimuth from the topic.
+  void moveSweep();
+  // Called on the executor thread, only hands the message over.
+  void onParameters(const std_msgs::msg::Float32MultiArray & message);
+  // Applies the latest live parameters that moved past the change threshold.
+  void applyLiveParams();
+
+  // Forgets the cached transform, so that the next update resolves it again.
+  void invalidateTransform();
+  void updateTransform();
+  // True if the chain from frame to the fixed frame only has static
+  // transforms.
+  bool isStaticFrame(const std::string & frame) const;
+  void reportUpdateTime(std::chrono::steady_clock::time_point start);
+  // Shows the counters of the grid as status entries and publishes them on
+  // the metrics topic, if any.
+  void reportMetrics();
+  // Frees the buffers once the grid has been disabled or hidden for the
+  // release time, unless it comes back first.
+  void scheduleRelease();
+  void cancelRelease();
+
+  // Unset until the first lookup after an invalidation.
+  std::optional<bool> transform_ok_;
+  bool static_checked_ = false;
+  bool static_frame_ = false;
+  Ogre::Vector3 position_ = Ogre::Vector3::ZERO;
+  Ogre::Quaternion orientation_ = Ogre::Quaternion::IDENTITY;
+  double update_time_ = 0.0;
+  std::chrono::steady_clock::time_point update_time_reported_;
+  QTimer release_timer_;
+
+  LatestValue<LiveParams> live_params_;
+  std::optional<LiveParams> applied_params_;
+  LatestValue<sensor_msgs::msg::Image> heatmap_images_;
+  // Bearing of the leading edge of the sweep in degrees.
+  double sweep_angle_ = 0.0;
+  std::chrono::steady_clock::time_point sweep_time_;
+  LatestValue<std_msgs::msg::Float32> sweep_azimuths_;
+  // Declared last so that they go before the mailboxes their callbacks write.
+  rclcpp::Subscription<std_msgs::msg::Float32MultiArray>::SharedPtr parameter_subscription_;
+  rclcpp::Subscription<sensor_msgs::msg::Image>::SharedPtr heatmap_subscription_;
+  rclcpp::Subscription<std_msgs::msg::Float32>::SharedPtr sweep_subscription_;
+  rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr metrics_publisher_;
 };
 
 }  // namespace polar_grid_rviz_plugins
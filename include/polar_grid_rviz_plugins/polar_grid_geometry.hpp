@@ -0,0 +1,141 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <polar_grid_rviz_plugins/unit_circle.hpp>
+
+namespace polar_grid_rviz_plugins
+{
+
+// Circles are split into bands, each uploaded as its own chunks, so changes
+// only regenerate the bands they touch. Bands hold at least kBandCircles
+// circles, and more on large grids so that there are at most kMaxBands.
+constexpr int kBandCircles = 16;
+constexpr int kMaxBands = 4;
+// Bands are further split into up to this many arcs of roughly square extent,
+// each with its own bounding box and scene node, so that the parts of a large
+// grid outside the view are culled.
+constexpr int kMaxBandSlices = 4;
+// Every slice costs a batch per tier and one for the spokes, so a grid is
+// drawn in at most this many slices.
+constexpr int kMaxSlices = kMaxBands * kMaxBandSlices;
+// Slices are at least this long in meters, so small grids stay in one or two
+// slices per band.
+constexpr float kMinSliceExtent = 32.f;
+
+// Circles are either major, every major_every-th step of the radius, or
+// minor. Each tier is uploaded separately so the minor circles can be faded
+// out on their own.
+enum class RingTier
+{
+  kMajor = 0,
+  kMinor = 1,
+};
+
+// Parameters the line geometry of a polar grid is generated from. Angles are
+// in degrees.
+struct PolarGridParams
+{
+  float min_radius = 0.f;
+  float radius_step = 1.f;
+  int circles_count = 5;
+  bool sectors = false;
+  float min_angle = -180.f;
+  float max_angle = 180.f;
+  int sector_count = 8;
+  bool invert = false;
+  // Every major_every-th circle is major, all circles are if 1 or less.
+  int major_every = 0;
+  // Segments of a full circle are 2^ring_levels[i], 360 if empty.
+  std::vector<int> ring_levels;
+};
+
+// Line list geometry of one chunk of a polar grid staged on the CPU before
+// upload. A chunk is either one tier of the circles or the spokes within one
+// slice of a band.
+struct PolarGridGeometry
+{
+  bool spokes = false;
+  int band = 0;
+  int slice = 0;
+  RingTier tier = RingTier::kMajor;
+  std::vector<float> positions;
+  // Bounding box of the positions, minimum x, y, z then maximum x, y, z.
+  float bounds[6] = {};
+  std::vector<uint32_t> indices;
+  // Unit circle tables used by the circles, kept cached until the next build.
+  std::vector<std::shared_ptr<const UnitCircle>> tables;
+  // Content key, see chunkKey(). Only set by callers that share chunks.
+  std::string key;
+  // Set by callers that skipped generating a chunk whose key is already
+  // uploaded, positions and indices are left empty.
+  bool cached = false;
+};
+
+// Arc covered by the circles, from start_angle to end_angle > start_angle.
+void angularRange(const PolarGridParams & params, float & start_angle, float & end_angle);
+float ringRadius(const PolarGridParams & params, int ring);
+// Segments of a circle over an arc of span degrees, 0 if the arc is empty.
+int ringSegments(const PolarGridParams & params, int ring, float span);
+// Circles per band.
+int bandCircles(const PolarGridParams & params);
+int bandCount(const PolarGridParams & params);
+int bandSlices(const PolarGridParams & params, int band);
+RingTier ringTier(const PolarGridParams & params, int ring);
+
+// Key of the geometry of one chunk, built from only the parameters the chunk
+// depends on. Chunks of different grids with equal keys are identical.
+std::string chunkKey(
+  const PolarGridParams & params, int band, int slice, bool spokes, RingTier tier);
+
+// Sizes of the buffers writeBand() and writeSpokes() fill.
+void countBand(
+  const PolarGridParams & params, int band, int slice, RingTier tier, size_t & vertices,
+  size_t & indices);
+void countSpokes(
+  const PolarGridParams & params, int band, int slice, size_t & vertices, size_t & indices);
+
+// Write the line list of the circles of one tier of a band slice, or of the
+// sector spokes crossing it, into caller-provided buffers of 3 floats per
+// vertex. Indices start at 0. The unit circle tables used are appended to
+// tables if given.
+void writeBand(
+  const PolarGridParams & params, int band, int slice, RingTier tier, float * positions,
+  uint32_t * indices, std::vector<std::shared_ptr<const UnitCircle>> * tables = nullptr);
+void writeSpokes(
+  const PolarGridParams & params, int band, int slice, float * positions, uint32_t * indices);
+
+// Same as above, sizing the buffers of geometry and computing its bounds.
+void buildBand(
+  const PolarGridParams & params, int band, int slice, RingTier tier,
+  PolarGridGeometry & geometry);
+void buildSpokes(const PolarGridParams & params, int band, int slice, PolarGridGeometry & geometry);
+
+}  // namespace polar_grid_rviz_plugins
@@ -0,0 +1,124 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <OgreCamera.h>
+#include <OgreFont.h>
+#include <OgreManualObject.h>
+#include <OgreMaterial.h>
+#include <OgreSceneManager.h>
+#include <OgreSceneNode.h>
+
+#include <polar_grid_rviz_plugins/polar_grid_geometry.hpp>
+
+namespace polar_grid_rviz_plugins
+{
+
+// Range labels on the circles and bearing labels on the spokes, drawn as a
+// single mesh of glyph quads from the font atlas. The vertex program turns
+// the quads to face the camera, so the mesh is only rebuilt when the set of
+// labels shown changes.
+class PolarGridLabels
+{
+public:
+  PolarGridLabels(
+    Ogre::SceneManager * scene_manager, Ogre::SceneNode * scene_node, const std::string & name);
+  // Frees the mesh and the material, so labels of the same name can be
+  // created again.
+  ~PolarGridLabels();
+
+  // False if the font or the label material could not be loaded, nothing is
+  // drawn then.
+  bool isSupported() const;
+
+  // Lays the labels out again if the parameters they depend on changed.
+  void setParams(const PolarGridParams & params);
+  // Labels of minor circles are only shown while the minor circles are.
+  void setMinorVisible(bool minor_visible);
+  void setColor(const Ogre::ColourValue & color);
+  // Height of the characters in meters.
+  void setCharHeight(float char_height);
+  void setVisible(bool visible);
+
+  // Culls the labels too small to read, off screen or overlapping a label of
+  // higher priority for the given camera, and rebuilds the mesh if that
+  // changed the labels shown.
+  void update(const Ogre::Camera * camera);
+  size_t getShownCount() const;
+
+private:
+  // Quad of one glyph, offsets are relative to the anchor of its label in
+  // character heights.
+  struct Glyph
+  {
+    float left, bottom, right, top;
+    Ogre::Font::UVRect uv;
+  };
+
+  // Labels are sorted by priority, earlier ones win overlaps.
+  struct Label
+  {
+    Ogre::Vector3 anchor;
+    bool minor;
+    size_t first_glyph, glyph_count;
+    // Extent of the glyphs in character heights.
+    float left, bottom, right, top;
+  };
+
+  void layout();
+  void addLabel(
+    const std::string & text, const Ogre::Vector3 & anchor, bool minor, float align_x,
+    float align_y);
+  void rebuild();
+
+  Ogre::SceneManager * scene_manager_;
+  Ogre::SceneNode * scene_node_;
+  Ogre::FontPtr font_;
+  Ogre::MaterialPtr material_;
+  std::shared_ptr<Ogre::ManualObject> mesh_;
+  size_t vertex_capacity_;
+  size_t index_capacity_;
+  bool degree_sign_;
+
+  PolarGridParams params_;
+  bool minor_visible_;
+  float char_height_;
+  bool visible_;
+  // The glyphs changed since the last rebuild.
+  bool dirty_;
+
+  std::vector<Glyph> glyphs_;
+  std::vector<Label> labels_;
+  std::vector<bool> shown_;
+  // Accepted screen rectangles bucketed in cells, reused by update().
+  std::vector<std::vector<uint32_t>> cells_;
+  std::vector<Ogre::Vector4> rects_;
+};
+
+}  // namespace polar_grid_rviz_plugins
@@ -0,0 +1,82 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <OgreSceneManager.h>
+#include <OgreSceneNode.h>
+#include <OgreTexture.h>
+
+#include <polar_grid_rviz_plugins/polar_grid_geometry.hpp>
+#include <polar_grid_rviz_plugins/shader_quad.hpp>
+#include <sensor_msgs/msg/image.hpp>
+
+namespace polar_grid_rviz_plugins
+{
+
+// Filled polar cells coloured from a range-azimuth array. The array is
+// uploaded as is into a texture, which a fragment program maps onto the
+// annular sector of the grid, so the cost per message is one texture upload
+// whatever the number of cells.
+class PolarHeatmap
+{
+public:
+  enum class ColorMap
+  {
+    kTurbo = 0,
+    kGrayscale = 1,
+  };
+
+  PolarHeatmap(Ogre::SceneManager * scene_manager, Ogre::SceneNode * parent_node);
+  // Frees the texture, the quad frees itself and its material.
+  ~PolarHeatmap();
+
+  // False if the heatmap material is not available, nothing is drawn then.
+  bool isSupported() const;
+
+  // Rows of the image are range bins from the minimum radius outwards and
+  // columns azimuth bins from the start of the sector arc. Accepts mono8,
+  // 8UC1, mono16, 16UC1 and 32FC1. Returns false and sets error if the image
+  // cannot be used.
+  bool upload(const sensor_msgs::msg::Image & image, std::string & error);
+  // The cells span the circles and the sector arc of params.
+  void setParams(const PolarGridParams & params);
+  // Values mapped to both ends of the colour map, in the units of the image.
+  void setValueRange(float min_value, float max_value);
+  void setColorMap(ColorMap color_map);
+  void setAlpha(float alpha);
+  void setVisible(bool visible);
+  // Empty until the first array is uploaded.
+  std::string getTextureName() const;
+
+private:
+  std::string name_;
+  Ogre::TexturePtr texture_;
+  std::unique_ptr<ShaderQuad> quad_;
+  bool visible_;
+};
+
+}  // namespace polar_grid_rviz_plugins
@@ -0,0 +1,71 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <OgreColourValue.h>
+#include <OgreGpuProgramParams.h>
+#include <OgreSceneManager.h>
+#include <OgreSceneNode.h>
+
+#include <polar_grid_rviz_plugins/polar_grid_geometry.hpp>
+#include <polar_grid_rviz_plugins/shader_quad.hpp>
+
+namespace polar_grid_rviz_plugins
+{
+
+// Radar sweep over a polar grid, a wedge with a fading trail drawn by a
+// fragment program on a quad. Moving the sweep only sets one uniform, so it
+// costs no geometry per frame.
+class PolarSweep
+{
+public:
+  PolarSweep(Ogre::SceneManager * scene_manager, Ogre::SceneNode * parent_node);
+
+  // False if the sweep material is not available, nothing is drawn then.
+  bool isSupported() const;
+
+  // The sweep spans the circles and the sector arc of params. Cheap if they
+  // did not change.
+  void setParams(const PolarGridParams & params);
+  void setColor(const Ogre::ColourValue & color);
+  // Angle the trail covers behind the leading edge in degrees, on the side
+  // the sweep comes from.
+  void setTrail(float trail, bool counterclockwise);
+  // Bearing of the leading edge in degrees.
+  void setAngle(float angle);
+  void setVisible(bool visible);
+
+private:
+  std::string name_;
+  std::unique_ptr<ShaderQuad> quad_;
+  PolarGridParams params_;
+  bool has_params_ = false;
+  // Parameters of the fragment program, kept for the per-frame angle.
+  Ogre::GpuProgramParametersSharedPtr fragment_;
+};
+
+}  // namespace polar_grid_rviz_plugins
@@ -0,0 +1,72 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <OgreManualObject.h>
+#include <OgreMaterial.h>
+#include <OgrePass.h>
+#include <OgreSceneManager.h>
+#include <OgreSceneNode.h>
+
+namespace polar_grid_rviz_plugins
+{
+
+// Unit quad drawn with a private clone of a shader material. The vertex
+// program scales it to the extent of the grid and the fragment program draws
+// the procedural grid, the heatmap or the sweep on it.
+class ShaderQuad
+{
+public:
+  // Clones the material base as name + "Material" and attaches the quad, named
+  // name, hidden to parent_node.
+  ShaderQuad(
+    Ogre::SceneManager * scene_manager, Ogre::SceneNode * parent_node, const std::string & name,
+    const std::string & base);
+  // Destroys the quad and removes the material.
+  ~ShaderQuad();
+
+  ShaderQuad(const ShaderQuad &) = delete;
+  ShaderQuad & operator=(const ShaderQuad &) = delete;
+
+  // False if the material is not available, nothing is drawn then.
+  bool isSupported() const;
+  const Ogre::MaterialPtr & getMaterial() const;
+  Ogre::Pass * getPass() const;
+  Ogre::ManualObject * getObject() const;
+  // Half side of the quad in meters, passed to the vertex program and used
+  // for the bounding box.
+  void setExtent(float extent);
+  void setVisible(bool visible);
+
+private:
+  Ogre::MaterialPtr material_;
+  // First pass of the best technique of the material.
+  Ogre::Pass * pass_ = nullptr;
+  std::shared_ptr<Ogre::ManualObject> quad_;
+};
+
+}  // namespace polar_grid_rviz_plugins
@@ -0,0 +1,53 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace polar_grid_rviz_plugins
+{
+
+// Cosines and sines of segments + 1 evenly spaced angles of an arc.
+struct UnitCircle
+{
+  std::vector<float> cos;
+  std::vector<float> sin;
+};
+
+// Returns the table of the arc from start to start + span degrees split into
+// segments. Tables are shared by all circles and all grids and computed on
+// first use. Callers keep the returned pointer alive for as long as they
+// want the table to stay cached.
+std::shared_ptr<const UnitCircle> getUnitCircle(float start, float span, int segments);
+
+// Writes (radius * cos, radius * sin, 0) of the first count points of the
+// table to out, which must have room for 3 floats per point.
+void scaleUnitCircle(
+  const UnitCircle & circle, float radius, float * out,
+  size_t count = std::numeric_limits<size_t>::max());
+
+}  // namespace polar_grid_rviz_plugins
@@ -0,0 +1,54 @@
+#version 120
+
+// Draws the circles and the sector spokes of a polar grid analytically. All
+// angles are in radians and the arc spans [start_angle, start_angle + span].
+
+uniform vec4 color;
+uniform float min_radius;
+uniform float first_radius;
+uniform float max_radius;
+uniform float radius_step;
+uniform float circles_count;
+uniform float sectors;
+uniform float start_angle;
+uniform float span;
+uniform float sector_count;
+
+varying vec2 position;
+
+const float kTwoPi = 6.28318530717959;
+
+void main()
+{
+  float radius = length(position);
+  // World size of one pixel, lines are one pixel wide.
+  float pixel = max(length(vec2(dFdx(radius), dFdy(radius))), 1e-6);
+  float angle = mod(atan(position.y, position.x) - start_angle, kTwoPi);
+  bool in_arc = angle <= span;
+
+  float coverage = 0.0;
+  if (in_arc && circles_count > 0.0 && radius <= max_radius + pixel) {
+    float step = max(radius_step, 1e-6);
+    float k = clamp(floor((radius - first_radius) / step + 0.5), 0.0, circles_count - 1.0);
+    float distance = abs(radius - (first_radius + k * step));
+    coverage = max(coverage, 1.0 - distance / pixel);
+  }
+
+  if (sectors > 0.5 && radius >= min_radius - pixel && radius <= max_radius + pixel) {
+    float gap;
+    if (in_arc) {
+      float step = span / sector_count;
+      gap = abs(angle - clamp(floor(angle / step + 0.5), 0.0, sector_count) * step);
+    } else {
+      gap = min(angle - span, kTwoPi - angle);
+    }
+    float distance = radius * sin(min(gap, 1.5707963));
+    coverage = max(coverage, 1.0 - distance / pixel);
+  }
+
+  coverage = clamp(coverage, 0.0, 1.0);
+  if (coverage <= 0.0) {
+    discard;
+  }
+  gl_FragColor = vec4(color.rgb, color.a * coverage);
+}
@@ -0,0 +1,14 @@
+#version 120
+
+// Scales the unit quad to the extent of the polar grid.
+
+uniform mat4 worldViewProj;
+uniform float extent;
+
+varying vec2 position;
+
+void main()
+{
+  position = gl_Vertex.xy * extent;
+  gl_Position = worldViewProj * vec4(position, 0.0, 1.0);
+}
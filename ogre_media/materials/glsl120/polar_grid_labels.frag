@@ -0,0 +1,17 @@
+#version 120
+
+// Tints the coverage of the glyph atlas.
+
+uniform sampler2D atlas;
+uniform vec4 color;
+
+varying vec2 uv;
+
+void main()
+{
+  float coverage = texture2D(atlas, uv).a;
+  if (coverage <= 0.0) {
+    discard;
+  }
+  gl_FragColor = vec4(color.rgb, color.a * coverage);
+}
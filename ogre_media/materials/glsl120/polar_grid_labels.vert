@@ -0,0 +1,18 @@
+#version 120
+
+// Offsets the corners of the glyph quads from their label anchor in view
+// space, so the labels always face the camera.
+
+uniform mat4 worldView;
+uniform mat4 projection;
+uniform float size;
+
+varying vec2 uv;
+
+void main()
+{
+  vec4 view = worldView * gl_Vertex;
+  view.xy += gl_MultiTexCoord1.xy * size;
+  uv = gl_MultiTexCoord0.xy;
+  gl_Position = projection * view;
+}
@@ -0,0 +1,58 @@
+#version 120
+
+// Maps a range-azimuth texture onto the annular sector of a polar grid. Rows
+// of the texture are range bins from min_radius to max_radius, columns are
+// azimuth bins from start_angle over span, both in radians.
+
+uniform sampler2D data;
+uniform float min_radius;
+uniform float max_radius;
+uniform float start_angle;
+uniform float span;
+uniform float min_value;
+uniform float max_value;
+// Raw value of a texel of 1.0, 255 or 65535 for normalized formats.
+uniform float value_scale;
+// 0 for turbo, 1 for grayscale.
+uniform float color_map;
+uniform float alpha;
+
+varying vec2 position;
+
+const float kTwoPi = 6.28318530718;
+
+// Polynomial approximation of the Turbo colour map.
+vec3 turbo(float x)
+{
+  const vec4 kRed4 = vec4(0.13572138, 4.61539260, -42.66032258, 132.13108234);
+  const vec4 kGreen4 = vec4(0.09140261, 2.19418839, 4.84296658, -14.18503333);
+  const vec4 kBlue4 = vec4(0.10667330, 12.64194608, -60.58204836, 110.36276771);
+  const vec2 kRed2 = vec2(-152.94239396, 59.28637943);
+  const vec2 kGreen2 = vec2(4.27729857, 2.82956604);
+  const vec2 kBlue2 = vec2(-89.90310912, 27.34824973);
+  vec4 v4 = vec4(1.0, x, x * x, x * x * x);
+  vec2 v2 = v4.zw * v4.z;
+  return vec3(
+    dot(v4, kRed4) + dot(v2, kRed2),
+    dot(v4, kGreen4) + dot(v2, kGreen2),
+    dot(v4, kBlue4) + dot(v2, kBlue2));
+}
+
+void main()
+{
+  float radius = length(position);
+  float angle = mod(atan(position.y, position.x) - start_angle, kTwoPi);
+  if (radius < min_radius || radius > max_radius || angle > span) {
+    discard;
+  }
+
+  vec2 uv = vec2(angle / span, (radius - min_radius) / max(max_radius - min_radius, 1e-6));
+  float value = texture2D(data, uv).r * value_scale;
+  // NaN cells are left empty.
+  if (value != value) {
+    discard;
+  }
+  float x = clamp((value - min_value) / max(max_value - min_value, 1e-6), 0.0, 1.0);
+  vec3 color = color_map < 0.5 ? turbo(x) : vec3(x);
+  gl_FragColor = vec4(color, alpha);
+}
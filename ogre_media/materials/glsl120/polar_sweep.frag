@@ -0,0 +1,35 @@
+#version 120
+
+// Draws a radar sweep over the annular sector of a polar grid, a wedge whose
+// leading edge is at angle and whose trail fades out over the trail angle
+// behind it. All angles are in radians, direction is 1 for a counterclockwise
+// sweep and -1 for a clockwise one.
+
+uniform vec4 color;
+uniform float min_radius;
+uniform float max_radius;
+uniform float start_angle;
+uniform float span;
+uniform float angle;
+uniform float trail;
+uniform float direction;
+
+varying vec2 position;
+
+const float kTwoPi = 6.28318530717959;
+
+void main()
+{
+  float radius = length(position);
+  float bearing = atan(position.y, position.x);
+  if (radius < min_radius || radius > max_radius || mod(bearing - start_angle, kTwoPi) > span) {
+    discard;
+  }
+
+  float behind = mod(direction * (angle - bearing), kTwoPi);
+  if (behind > trail) {
+    discard;
+  }
+  float fade = 1.0 - behind / max(trail, 1e-6);
+  gl_FragColor = vec4(color.rgb, color.a * fade * fade);
+}
@@ -0,0 +1,230 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <polar_grid_rviz_plugins/multi_polar_grid_display.hpp>
+#include <rviz_common/display_context.hpp>
+#include <rviz_common/frame_manager_iface.hpp>
+#include <rviz_common/logging.hpp>
+#include <rviz_common/properties/status_property.hpp>
+
+namespace polar_grid_rviz_plugins {
+
+  namespace {
+
+  constexpr int kMaxGrids = 64;
+
+  }  // namespace
+
+  MultiPolarGridDisplay::MultiPolarGridDisplay()
+  {
+    frame_property_ = std::make_unique < rviz_common::properties::TfFrameProperty > (
+      "Reference Frame", rviz_common::properties::TfFrameProperty::FIXED_FRAME_STRING,
+      "The TF frame the grids are batched in, pick one the grid frames are rigidly attached to.",
+      this, nullptr, true);
+
+    color_property_ = std::make_unique < rviz_common::properties::ColorProperty > (
+      "Color", Qt::gray, "The color of the circles.", this, SLOT(updateColor()));
+    alpha_property_ = std::make_unique < rviz_common::properties::FloatProperty > (
+      "Alpha", 0.5f, "The amount of transparency to apply to the circles.", this,
+      SLOT(updateColor()));
+    alpha_property_->setMin(0.f);
+    alpha_property_->setMax(1.f);
+
+    grid_count_property_ = std::make_unique < rviz_common::properties::IntProperty > (
+      "Grid Count", 1, "The number of polar grids.", this, SLOT(updateGridCount()));
+    grid_count_property_->setMin(0);
+    grid_count_property_->setMax(kMaxGrids);
+
+    grids_.push_back(createGrid(0));
+  }
+
+  MultiPolarGridDisplay::GridProperties MultiPolarGridDisplay::createGrid(int index)
+  {
+    GridProperties grid;
+    grid.group = std::make_unique < rviz_common::properties::Property > (
+      QString("Grid %1").arg(index + 1), QVariant(), "Properties of one polar grid.", this);
+
+    grid.frame = new rviz_common::properties::TfFrameProperty(
+      "Frame", rviz_common::properties::TfFrameProperty::FIXED_FRAME_STRING,
+      "The TF frame this polar grid will use for its origin.", grid.group.get(), nullptr, true);
+    grid.offset = new rviz_common::properties::VectorProperty(
+      "Offset", Ogre::Vector3::ZERO, "The origin of the polar grid in meters.", grid.group.get());
+    grid.min_radius = new rviz_common::properties::FloatProperty(
+      "Minimum Radius", 0.0f, "The minimum radius of the polar grid.", grid.group.get(),
+      SLOT(updateGrids()), this);
+    grid.min_radius->setMin(0.f);
+    grid.radius_step = new rviz_common::properties::FloatProperty(
+      "Radius Step", 1.0f, "The step size for radius increments.", grid.group.get(),
+      SLOT(updateGrids()), this);
+    grid.radius_step->setMin(0.f);
+    grid.circles_count = new rviz_common::properties::IntProperty(
+      "Circles Count", 5, "The number of circles to draw.", grid.group.get(),
+      SLOT(updateGrids()), this);
+    grid.circles_count->setMin(0);
+
+    grid.sectors = new rviz_common::properties::BoolProperty(
+      "Sectors", false, "Sectors properties.", grid.group.get(), SLOT(updateGrids()), this);
+    grid.sectors->setDisableChildrenIfFalse(true);
+    grid.min_angle = new rviz_common::properties::IntProperty(
+      "Minimum Angle", -180, "The minimum angle of the sectors.", grid.sectors,
+      SLOT(updateGrids()), this);
+    grid.min_angle->setMin(-180);
+    grid.min_angle->setMax(180);
+    grid.max_angle = new rviz_common::properties::IntProperty(
+      "Maximum Angle", 180, "The maximum angle of the sectors.", grid.sectors,
+      SLOT(updateGrids()), this);
+    grid.max_angle->setMin(-180);
+    grid.max_angle->setMax(180);
+    grid.sector_count = new rviz_common::properties::IntProperty(
+      "Sector Count", 8, "The number of sectors to draw.", grid.sectors, SLOT(updateGrids()),
+      this);
+    grid.sector_count->setMin(1);
+    grid.invert = new rviz_common::properties::BoolProperty(
+      "Invert", false, "Invert the sector region.", grid.sectors, SLOT(updateGrids()), this);
+
+    if (context_) {
+      grid.frame->setFrameManager(context_->getFrameManager());
+    }
+    return grid;
+  }
+
+  void MultiPolarGridDisplay::onInitialize()
+  {
+    Display::onInitialize();
+
+    frame_property_->setFrameManager(context_->getFrameManager());
+    for (GridProperties & grid : grids_) {
+      grid.frame->setFrameManager(context_->getFrameManager());
+    }
+
+    batch_ = std::make_unique < PolarGridBatch > (scene_manager_, scene_node_);
+
+    updateColor();
+    updateGridCount();
+  }
+
+  void MultiPolarGridDisplay::load(const rviz_common::Config & config)
+  {
+    int count = 0;
+    if (config.mapGetInt("Grid Count", &count)) {
+      grid_count_property_->setInt(count);
+    }
+    Display::load(config);
+  }
+
+  void MultiPolarGridDisplay::update(float /* dt */, float /* ros_dt */)
+  {
+    rviz_common::FrameManagerIface * frame_manager = context_->getFrameManager();
+    std::string reference = frame_property_->getFrame().toStdString();
+    Ogre::Vector3 reference_position;
+    Ogre::Quaternion reference_orientation;
+    if (!frame_manager->getTransform(reference, reference_position, reference_orientation)) {
+      setMissingTransformToFixedFrame(reference);
+      batch_->setVisible(false);
+      return;
+    }
+    setTransformOk();
+    batch_->setVisible(true);
+    scene_node_->setPosition(reference_position);
+    scene_node_->setOrientation(reference_orientation);
+
+    // Poses relative to the reference frame stay put while the vehicle
+    // moves, so the batch only rebuilds when a grid actually moves on it.
+    Ogre::Quaternion inverse = reference_orientation.Inverse();
+    for (size_t i = 0; i < grids_.size(); ++i) {
+      const GridProperties & grid = grids_[i];
+      std::string frame = grid.frame->getFrame().toStdString();
+      Ogre::Vector3 position;
+      Ogre::Quaternion orientation;
+      if (!frame_manager->getTransform(frame, position, orientation)) {
+        batch_->setGridVisible(i, false);
+        setStatus(
+          rviz_common::properties::StatusProperty::Warn, grid.group->getName(),
+          QString("No transform from [%1] to the fixed frame").arg(frame.c_str()));
+        continue;
+      }
+      deleteStatus(grid.group->getName());
+      orientation = inverse * orientation;
+      position = inverse * (position - reference_position) + orientation * grid.offset->getVector();
+      batch_->setPose(i, position, orientation);
+      batch_->setGridVisible(i, true);
+    }
+
+    if (batch_->update()) {
+      setStatus(
+        rviz_common::properties::StatusProperty::Ok, "Geometry",
+        QString("%1 vertices in %2 grids").arg(batch_->getVertexCount()).arg(grids_.size()));
+    }
+  }
+
+  void MultiPolarGridDisplay::updateColor()
+  {
+    Ogre::ColourValue color = color_property_->getOgreColor();
+    batch_->setColor(color.r, color.g, color.b, alpha_property_->getFloat());
+    context_->queueRender();
+  }
+
+  void MultiPolarGridDisplay::updateGridCount()
+  {
+    size_t count = static_cast < size_t > (grid_count_property_->getInt());
+    while (grids_.size() > count) {
+      deleteStatus(grids_.back().group->getName());
+      grids_.pop_back();
+    }
+    while (grids_.size() < count) {
+      grids_.push_back(createGrid(static_cast < int > (grids_.size())));
+    }
+    if (batch_) {
+      batch_->resize(count);
+      updateGrids();
+    }
+  }
+
+  void MultiPolarGridDisplay::updateGrids()
+  {
+    for (size_t i = 0; i < grids_.size(); ++i) {
+      const GridProperties & grid = grids_[i];
+      PolarGridParams params;
+      params.min_radius = grid.min_radius->getFloat();
+      params.radius_step = grid.radius_step->getFloat();
+      params.circles_count = grid.circles_count->getInt();
+      params.sectors = grid.sectors->getBool();
+      params.min_angle = static_cast < float > (grid.min_angle->getInt());
+      params.max_angle = static_cast < float > (grid.max_angle->getInt());
+      params.sector_count = grid.sector_count->getInt();
+      params.invert = grid.invert->getBool();
+      if (params.min_angle >= params.max_angle) {
+        RVIZ_COMMON_LOG_ERROR_STREAM(
+          grid.group->getName().toStdString() <<
+            ": minimum angle must be less than maximum angle.");
+        continue;
+      }
+      batch_->setParams(i, params);
+    }
+    context_->queueRender();
+  }
+
+}  // namespace polar_grid_rviz_plugins
+
+#include <pluginlib/class_list_macros.hpp>
+PLUGINLIB_EXPORT_CLASS(polar_grid_rviz_plugins::MultiPolarGridDisplay, rviz_common::Display)
@@ -21,92 +21,647 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <OgrePass.h>
+#include <OgreViewport.h>
+
 #include <polar_grid_rviz_plugins/polar_grid.hpp>
 #include <rviz_common/logging.hpp>
 #include <rviz_rendering/material_manager.hpp>
 
 namespace polar_grid_rviz_plugins {
 
+  namespace {
+
+  constexpr int kMinRingLevel = 3;
+  constexpr int kMaxRingLevel = 13;
+  // Rebuilds with more vertices are generated on the worker thread.
+  constexpr size_t kAsyncVertices = 1 << 16;
+  constexpr const char * kTierNames[] = {"Major", "Minor"};
+
+  double elapsed(std::chrono::steady_clock::time_point start)
+  {
+    return std::chrono::duration < double, std::micro > (
+      std::chrono::steady_clock::now() - start).count();
+  }
+
+  // Generates one chunk of a job, or only records its key if the job shares
+  // its chunks and an identical one is already uploaded.
+  void buildChunk(
+    const PolarGridJob & job, int band, int slice, bool spokes, RingTier tier,
+    PolarGridGeometry & geometry)
+  {
+    geometry.cached = false;
+    geometry.key.clear();
+    if (job.shared) {
+      geometry.key = chunkKey(job.params, band, slice, spokes, tier);
+      if (isMeshCached(geometry.key)) {
+        geometry.cached = true;
+        geometry.spokes = spokes;
+        geometry.band = band;
+        geometry.slice = slice;
+        geometry.tier = tier;
+        geometry.positions.clear();
+        geometry.indices.clear();
+        geometry.tables.clear();
+        return;
+      }
+    }
+    if (spokes) {
+      buildSpokes(job.params, band, slice, geometry);
+    } else {
+      buildBand(job.params, band, slice, tier, geometry);
+    }
+  }
+
+  // Generates the chunks of a job into build. Gives up and returns false as
+  // soon as latest moves past the generation of the job.
+  bool buildJob(
+    const PolarGridJob & job, PolarGridBuild & build, const std::atomic < uint64_t > & latest)
+  {
+    auto start = std::chrono::steady_clock::now();
+    build.generation = job.generation;
+    int bands = bandCount(job.params);
+    size_t chunks = 0;
+    for (int band : job.bands) {
+      chunks += 2 * bandSlices(job.params, band);
+    }
+    for (int i = 0; job.spokes && i < bands; ++i) {
+      chunks += bandSlices(job.params, i);
+    }
+    build.chunks.resize(chunks);
+
+    PolarGridGeometry * chunk = build.chunks.data();
+    for (int band : job.bands) {
+      if (latest.load(std::memory_order_relaxed) != job.generation) {
+        return false;
+      }
+      for (int i = 0; i < bandSlices(job.params, band); ++i) {
+        buildChunk(job, band, i, false, RingTier::kMajor, *chunk++);
+        buildChunk(job, band, i, false, RingTier::kMinor, *chunk++);
+      }
+    }
+    for (int band = 0; job.spokes && band < bands; ++band) {
+      for (int i = 0; i < bandSlices(job.params, band); ++i) {
+        buildChunk(job, band, i, true, RingTier::kMajor, *chunk++);
+      }
+    }
+    build.build_time = elapsed(start);
+    return true;
+  }
+
+  // Calls f(chunk, used) on every chunk of chunks, indexed by band then slice,
+  // used tells whether the chunk is part of the grid params describe.
+  template<typename Chunk, typename F>
+  void forEachChunk(
+    const PolarGridParams & params, std::vector < std::vector < Chunk >> & chunks, F f)
+  {
+    int bands = bandCount(params);
+    for (int i = 0; i < static_cast < int > (chunks.size()); ++i) {
+      int slices = i < bands ? bandSlices(params, i) : 0;
+      for (int j = 0; j < static_cast < int > (chunks[i].size()); ++j) {
+        f(chunks[i][j], j < slices);
+      }
+    }
+  }
+
+  }  // namespace
+
   PolarGrid::PolarGrid(Ogre::SceneManager * scene_manager, Ogre::SceneNode * parent_node)
   : rviz_rendering::Object(scene_manager)
   {
     static int count = 0;
-    std::string name = "PolarGrid" + std::to_string(count++);
-
-    polar_grid_ = std::shared_ptr < Ogre::ManualObject > (scene_manager->createManualObject(name));
+    name_ = "PolarGrid" + std::to_string(count++);
 
     if (!parent_node) {
       parent_node = scene_manager->getRootSceneNode();
     }
 
     scene_node_ = std::shared_ptr < Ogre::SceneNode > (parent_node->createChildSceneNode());
-    scene_node_->attachObject(polar_grid_.get());
 
-    material_ = rviz_rendering::MaterialManager::createMaterialWithNoLighting(name + "Material");
+    // The colour lives in the material rather than in the vertices, so colour
+    // changes never touch the geometry. Lighting only adds the emissive term
+    // since ambient and diffuse are black.
+    own_materials_[0] =
+      rviz_rendering::MaterialManager::createMaterialWithNoLighting(name_ + "Material");
+    own_materials_[0]->setLightingEnabled(true);
+    own_materials_[0]->setAmbient(Ogre::ColourValue::Black);
+    own_materials_[1] = own_materials_[0]->clone(name_ + "MinorMaterial");
+    tier_fade_[0] = tier_fade_[1] = 1.f;
+    share_geometry_ = false;
+    labels_enabled_ = false;
+    lod_pixel_spacing_ = 0.f;
+    label_color_ = Ogre::ColourValue::White;
+    label_size_ = 0.3f;
+
+    color_ = Ogre::ColourValue::Black;
+    setColor(1.f, 1.f, 1.f, 1.f);
+    pixel_tolerance_ = 0.f;
+    render_mode_ = RenderMode::kLines;
+    visible_ = true;
+    vertex_count_ = index_count_ = vertex_buffer_size_ = index_buffer_size_ = 0;
+    batch_count_ = 0;
+    dirty_ = kDirtyAll;
+    generation_ = 0;
+    uploaded_generation_ = 0;
+    pending_spokes_ = false;
+    stop_ = false;
+  }
+
+  PolarGrid::~PolarGrid()
+  {
+    {
+      std::lock_guard < std::mutex > lock(mutex_);
+      stop_ = true;
+      // Abandon the build in flight rather than wait for it.
+      ++generation_;
+    }
+    condition_.notify_one();
+    if (worker_.joinable()) {
+      worker_.join();
+    }
+  }
+
+  Ogre::MovableObject * PolarGrid::LineChunk::movable() const
+  {
+    if (entity) {
+      return entity.get();
+    }
+    return object.get();
+  }
 
-    color_ = Ogre::ColourValue::White;
-    min_radius_ = 0.f;
-    radius_step_ = 1.f;
-    circles_count_ = 5;
-    sectors_ = false;
-    min_angle_ = -180.f;
-    max_angle_ = 180.f;
-    sector_count_ = 8;
-    invert_ = false;
+  void PolarGrid::LineChunk::setMaterial(const Ogre::MaterialPtr & material)
+  {
+    if (entity) {
+      entity->setMaterial(material);
+    } else if (object && object->getNumSections() > 0) {
+      object->setMaterialName(0, material->getName(), "rviz_rendering");
+    }
   }
 
-  void PolarGrid::draw()
+  PolarGrid::LineChunk PolarGrid::createChunk(const std::string & name, Ogre::SceneNode * node)
   {
-    polar_grid_->clear();
-    polar_grid_->begin(material_->getName(), Ogre::RenderOperation::OT_LINE_LIST, "rviz_rendering");
+    // Shared chunks get an entity once their mesh is known.
+    LineChunk chunk;
+    if (share_geometry_) {
+      return chunk;
+    }
+    // Chunks are dropped when the grid switches to shared geometry, so they
+    // must leave the scene manager with them.
+    Ogre::SceneManager * scene_manager = scene_manager_;
+    chunk.object = std::shared_ptr < Ogre::ManualObject > (
+      scene_manager_->createManualObject(name), [scene_manager](Ogre::ManualObject * object) {
+        scene_manager->destroyManualObject(object);
+      });
+    chunk.object->setDynamic(true);
+    node->attachObject(chunk.object.get());
+    return chunk;
+  }
+
+  Ogre::SceneNode * PolarGrid::sliceNode(int band, int slice)
+  {
+    if (static_cast < int > (slice_nodes_.size()) <= band) {
+      slice_nodes_.resize(band + 1);
+    }
+    std::vector < std::shared_ptr < Ogre::SceneNode >> & nodes = slice_nodes_[band];
+    if (static_cast < int > (nodes.size()) <= slice) {
+      nodes.resize(slice + 1);
+    }
+    if (!nodes[slice]) {
+      Ogre::SceneManager * scene_manager = scene_manager_;
+      nodes[slice] = std::shared_ptr < Ogre::SceneNode > (
+        scene_node_->createChildSceneNode(), [scene_manager](Ogre::SceneNode * node) {
+          scene_manager->destroySceneNode(node);
+        });
+    }
+    return nodes[slice].get();
+  }
 
-    int start_angle = 0, end_angle = 0, two_pi = 360;
-    if (sectors_) {
-      if (invert_) {
-        start_angle = max_angle_;
-        end_angle = min_angle_ + two_pi;
+  bool PolarGrid::draw(bool all)
+  {
+    if (all) {
+      dirty_ |= kDirtyAll;
+    }
+
+    auto job = std::make_unique < PolarGridJob > ();
+    job->generation = ++generation_;
+    job->params = params_;
+    job->shared = share_geometry_;
+    int bands = bandCount(params_);
+    size_t vertices = 0;
+    for (int i = 0; i < bands; ++i) {
+      bool dirty = (dirty_ & kDirtyRings) ||
+        (i < static_cast < int > (dirty_bands_.size()) && dirty_bands_[i]) ||
+        (i < static_cast < int > (pending_bands_.size()) && pending_bands_[i]);
+      if (dirty) {
+        for (int j = 0; j < bandSlices(params_, i); ++j) {
+          for (RingTier tier : {RingTier::kMajor, RingTier::kMinor}) {
+            size_t slice_vertices = 0, slice_indices = 0;
+            countBand(params_, i, j, tier, slice_vertices, slice_indices);
+            vertices += slice_vertices;
+          }
+        }
+        job->bands.push_back(i);
+      }
+    }
+    job->spokes = (dirty_ & kDirtySectors) || pending_spokes_;
+    dirty_ = kDirtyNone;
+    dirty_bands_.clear();
+    applyVisibility();
+
+    if (vertices < kAsyncVertices) {
+      buildJob(*job, staging_, generation_);
+      upload(staging_);
+      return true;
+    }
+
+    // Remember what this build covers in case a newer one overtakes it.
+    pending_bands_.assign(bands, false);
+    for (int band : job->bands) {
+      pending_bands_[band] = true;
+    }
+    pending_spokes_ = job->spokes;
+    {
+      std::lock_guard < std::mutex > lock(mutex_);
+      job_ = std::move(job);
+    }
+    if (!worker_.joinable()) {
+      worker_ = std::thread(&PolarGrid::work, this);
+    }
+    condition_.notify_one();
+    return false;
+  }
+
+  void PolarGrid::work()
+  {
+    std::unique_lock < std::mutex > lock(mutex_);
+    while (true) {
+      condition_.wait(lock, [this] {return stop_ || job_;});
+      if (stop_) {
+        return;
+      }
+      std::unique_ptr < PolarGridJob > job = std::move(job_);
+      lock.unlock();
+
+      std::unique_ptr < PolarGridBuild > build = spare_.take();
+      if (!build) {
+        build = std::make_unique < PolarGridBuild > ();
+      }
+      if (buildJob(*job, *build, generation_)) {
+        ready_.store(std::move(build));
+      } else {
+        spare_.store(std::move(build));
+      }
+
+      lock.lock();
+    }
+  }
+
+  void PolarGrid::upload(const PolarGridBuild & build)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (const PolarGridGeometry & geometry : build.chunks) {
+      stats_.uploaded_bytes += sizeof(float) * geometry.positions.size() +
+        sizeof(uint32_t) * geometry.indices.size();
+      int tier = static_cast < int > (geometry.tier);
+      std::vector < std::vector < LineChunk >> & chunks = geometry.spokes ? spokes_ : bands_[tier];
+      if (static_cast < int > (chunks.size()) <= geometry.band) {
+        chunks.resize(geometry.band + 1);
+      }
+      std::vector < LineChunk > & slices = chunks[geometry.band];
+      Ogre::SceneNode * node = sliceNode(geometry.band, geometry.slice);
+      while (static_cast < int > (slices.size()) <= geometry.slice) {
+        slices.push_back(
+          createChunk(
+            name_ + (geometry.spokes ? "Spokes" : kTierNames[tier]) + "Band" +
+            std::to_string(geometry.band) + "Slice" + std::to_string(slices.size()),
+            sliceNode(geometry.band, static_cast < int > (slices.size()))));
+      }
+      if (share_geometry_) {
+        share(geometry, slices[geometry.slice], tier_materials_[tier], node);
       } else {
-        start_angle = min_angle_;
-        end_angle = max_angle_;
+        upload(geometry, slices[geometry.slice], tier_materials_[tier]);
       }
+    }
+    // Chunk bounds changed, so the slice node bounds used for culling must
+    // follow.
+    scene_node_->needUpdate();
+    uploaded_generation_ = build.generation;
+    pending_bands_.clear();
+    pending_spokes_ = false;
+    applyVisibility();
+    updateBufferSizes();
+    stats_.last_rebuild_time = build.build_time + elapsed(start);
+    stats_.rebuild_time += stats_.last_rebuild_time;
+    ++stats_.rebuilds;
+  }
+
+  void PolarGrid::upload(
+    const PolarGridGeometry & geometry, LineChunk & chunk, const Ogre::MaterialPtr & material)
+  {
+    // The hardware buffers are dynamic and only reallocated when the chunk
+    // outgrows them, other rebuilds overwrite them in place.
+    size_t vertices = geometry.positions.size() / 3;
+    size_t indices = geometry.indices.size();
+    if (vertices > chunk.vertex_capacity || indices > chunk.index_capacity) {
+      chunk.vertex_capacity = std::max(chunk.vertex_capacity, vertices + vertices / 2);
+      chunk.index_capacity = std::max(chunk.index_capacity, indices + indices / 2);
+    }
+    Ogre::ManualObject * object = chunk.object.get();
+    object->estimateVertexCount(chunk.vertex_capacity);
+    object->estimateIndexCount(chunk.index_capacity);
+    if (object->getNumSections() == 0) {
+      object->begin(material->getName(), Ogre::RenderOperation::OT_LINE_LIST, "rviz_rendering");
     } else {
-      start_angle = 0;
-      end_angle = two_pi;
-    }
-
-    float max_radius = 0.f;
-    for (int i = 0; i < circles_count_; ++i) {
-      float radius = min_radius_ + (i + (min_radius_ < 1e-6 ? 1 : 0)) * radius_step_;
-      if (i == circles_count_ - 1) {max_radius = radius;}
-      // XXX: May have better way, the number of points should not be fixed
-      for (int j = start_angle; j < end_angle; ++j) {
-        for (int k = 0; k < 2; ++k) {
-          float angle_rad = Ogre::Math::PI * (j + k) / 180.f;
-          float x = radius * Ogre::Math::Cos(angle_rad);
-          float y = radius * Ogre::Math::Sin(angle_rad);
-          polar_grid_->position(x, y, 0);
-          polar_grid_->colour(color_);
+      object->beginUpdate(0);
+    }
+    const float * p = geometry.positions.data();
+    for (size_t i = 0; i < vertices; ++i, p += 3) {
+      object->position(p[0], p[1], p[2]);
+    }
+    for (uint32_t index : geometry.indices) {
+      object->index(index);
+    }
+    object->end();
+    // Each chunk gets its own tight box, which its slice node bounds follow,
+    // so that Ogre culls the slices of the grid outside the view.
+    if (vertices > 0) {
+      const float * bounds = geometry.bounds;
+      object->setBoundingBox(
+        Ogre::AxisAlignedBox(bounds[0], bounds[1], bounds[2], bounds[3], bounds[4], bounds[5]));
+    }
+  }
+
+  void PolarGrid::share(
+    const PolarGridGeometry & geometry, LineChunk & chunk, const Ogre::MaterialPtr & material,
+    Ogre::SceneNode * node)
+  {
+    std::shared_ptr < const SharedMesh > mesh = acquireMesh(geometry);
+    if (!mesh && geometry.cached) {
+      // The other grids released the mesh after the build skipped it, so
+      // generate the chunk on the next update.
+      if (geometry.spokes) {
+        dirty_ |= kDirtySectors;
+      } else {
+        int circles = bandCircles(params_);
+        markRings(geometry.band * circles, geometry.band * circles + 1);
+      }
+      return;
+    }
+    if (mesh == chunk.mesh) {return;}
+    chunk.entity.reset();
+    chunk.mesh = mesh;
+    if (!mesh) {return;}
+    Ogre::SceneManager * scene_manager = scene_manager_;
+    chunk.entity = std::shared_ptr < Ogre::Entity > (
+      scene_manager_->createEntity(mesh->mesh), [scene_manager](Ogre::Entity * entity) {
+        scene_manager->destroyEntity(entity);
+      });
+    chunk.entity->setMaterial(material);
+    node->attachObject(chunk.entity.get());
+  }
+
+  bool PolarGrid::update()
+  {
+    bool changed = false;
+    if (std::unique_ptr < PolarGridBuild > build = ready_.take()) {
+      if (build->generation == generation_) {
+        upload(*build);
+        changed = true;
+      }
+      spare_.store(std::move(build));
+    }
+    if (!visible_ || !isDirty()) {
+      return changed;
+    }
+    // Bring back what releaseGeometry() freed.
+    if (labels_enabled_ && !labels_) {
+      setLabels(true);
+    }
+    if (render_mode_ == RenderMode::kProcedural) {
+      if (!quad_) {
+        if (!createProcedural()) {
+          render_mode_ = RenderMode::kLines;
+          return draw(true) || changed;
         }
+        applyVisibility();
       }
+      updateProcedural();
+      return true;
     }
+    return draw(false) || changed;
+  }
 
-    if (sectors_ && start_angle != end_angle) {
-      float angle_step = static_cast < float > (end_angle - start_angle) / sector_count_;
-      for (int i = 0; i < sector_count_ + 1; ++i) {
-        float angle_rad = Ogre::Math::PI * (start_angle + i * angle_step) / 180.f;
-        if (i == sector_count_ && start_angle + two_pi == end_angle) {continue;}
-        float x1 = min_radius_ * Ogre::Math::Cos(angle_rad);
-        float y1 = min_radius_ * Ogre::Math::Sin(angle_rad);
-        float x2 = max_radius * Ogre::Math::Cos(angle_rad);
-        float y2 = max_radius * Ogre::Math::Sin(angle_rad);
-        polar_grid_->position(x1, y1, 0);
-        polar_grid_->colour(color_);
-        polar_grid_->position(x2, y2, 0);
-        polar_grid_->colour(color_);
+  void PolarGrid::releaseGeometry()
+  {
+    bands_[0].clear();
+    bands_[1].clear();
+    spokes_.clear();
+    slice_nodes_.clear();
+    quad_.reset();
+    labels_.reset();
+    // Abandon the builds in flight along with their chunks.
+    uploaded_generation_ = ++generation_;
+    ready_.take();
+    spare_.take();
+    staging_ = PolarGridBuild();
+    pending_bands_.clear();
+    pending_spokes_ = false;
+    dirty_ = kDirtyAll;
+    updateBufferSizes();
+  }
+
+  bool PolarGrid::isBuilding() const {return uploaded_generation_ != generation_;}
+
+  void PolarGrid::markRings(int first, int last)
+  {
+    int circles = bandCircles(params_);
+    int first_band = first / circles;
+    int last_band = (last + circles - 1) / circles;
+    if (static_cast < int > (dirty_bands_.size()) < last_band) {
+      dirty_bands_.resize(last_band, false);
+    }
+    for (int i = first_band; i < last_band; ++i) {
+      dirty_bands_[i] = true;
+    }
+  }
+
+  void PolarGrid::applyVisibility()
+  {
+    bool lines = visible_ && render_mode_ == RenderMode::kLines;
+    for (int tier = 0; tier < 2; ++tier) {
+      bool shown = lines && tier_fade_[tier] > 0.f;
+      forEachChunk(
+        params_, bands_[tier], [shown](LineChunk & chunk, bool used) {
+          if (Ogre::MovableObject * object = chunk.movable()) {
+            object->setVisible(shown && used);
+          }
+        });
+    }
+    bool spokes = lines && params_.sectors;
+    forEachChunk(
+      params_, spokes_, [spokes](LineChunk & chunk, bool used) {
+        if (Ogre::MovableObject * object = chunk.movable()) {
+          object->setVisible(spokes && used);
+        }
+      });
+    if (quad_) {
+      quad_->setVisible(visible_ && render_mode_ == RenderMode::kProcedural);
+    }
+    if (labels_) {
+      labels_->setVisible(visible_);
+    }
+  }
+
+  void PolarGrid::setVisible(bool visible)
+  {
+    if (visible_ == visible) {return;}
+    visible_ = visible;
+    applyVisibility();
+  }
+
+  void PolarGrid::setRenderMode(RenderMode render_mode)
+  {
+    if (render_mode_ == render_mode) {return;}
+    if (render_mode == RenderMode::kProcedural && !quad_ && !createProcedural()) {
+      RVIZ_COMMON_LOG_ERROR("Procedural polar grid is not supported, falling back to lines.");
+      render_mode = RenderMode::kLines;
+    }
+    render_mode_ = render_mode;
+    applyVisibility();
+    dirty_ = kDirtyAll;
+  }
+
+  void PolarGrid::setShareGeometry(bool share_geometry)
+  {
+    if (share_geometry_ == share_geometry) {return;}
+    share_geometry_ = share_geometry;
+    // Chunks of the other kind are regenerated, and builds in flight were
+    // made for them.
+    bands_[0].clear();
+    bands_[1].clear();
+    spokes_.clear();
+    ++generation_;
+    if (!share_geometry_) {
+      shared_material_.reset();
+    }
+    applyColor();
+    dirty_ = kDirtyAll;
+    updateBufferSizes();
+  }
+
+  PolarGrid::RenderMode PolarGrid::getRenderMode() const {return render_mode_;}
+
+  const PolarGridParams & PolarGrid::getParams() const {return params_;}
+
+  bool PolarGrid::createProcedural()
+  {
+    quad_ = std::make_unique < ShaderQuad > (
+      scene_manager_, scene_node_.get(), name_ + "Procedural", "PolarGrid/Procedural");
+    if (!quad_->isSupported()) {
+      quad_.reset();
+      return false;
+    }
+    return true;
+  }
+
+  void PolarGrid::updateProcedural()
+  {
+    auto start = std::chrono::steady_clock::now();
+    float start_angle = 0.f, end_angle = 0.f;
+    angularRange(params_, start_angle, end_angle);
+    float first_radius = ringRadius(params_, 0);
+    float max_radius = params_.circles_count > 0 ?
+      ringRadius(params_, params_.circles_count - 1) : params_.min_radius;
+    // Leave room for the antialiased edge of the outermost circle.
+    float extent = std::max(max_radius * 1.01f + 0.01f, 0.01f);
+
+    quad_->setExtent(extent);
+    Ogre::GpuProgramParametersSharedPtr params =
+      quad_->getPass()->getFragmentProgramParameters();
+    params->setNamedConstant("color", color_);
+    params->setNamedConstant("min_radius", params_.min_radius);
+    params->setNamedConstant("first_radius", first_radius);
+    params->setNamedConstant("max_radius", max_radius);
+    params->setNamedConstant("radius_step", params_.radius_step);
+    params->setNamedConstant("circles_count", static_cast < float > (params_.circles_count));
+    params->setNamedConstant("sectors", params_.sectors ? 1.f : 0.f);
+    params->setNamedConstant("start_angle", Ogre::Math::PI * start_angle / 180.f);
+    params->setNamedConstant("span", Ogre::Math::PI * (end_angle - start_angle) / 180.f);
+    params->setNamedConstant("sector_count", static_cast < float > (params_.sector_count));
+
+    scene_node_->needUpdate();
+    dirty_ = kDirtyNone;
+    dirty_bands_.clear();
+    updateBufferSizes();
+    stats_.last_rebuild_time = elapsed(start);
+    stats_.rebuild_time += stats_.last_rebuild_time;
+    ++stats_.rebuilds;
+  }
+
+  void PolarGrid::updateBufferSizes()
+  {
+    vertex_count_ = index_count_ = vertex_buffer_size_ = index_buffer_size_ = 0;
+    batch_count_ = 0;
+    std::vector < Ogre::ManualObject * > objects;
+    if (render_mode_ == RenderMode::kProcedural) {
+      if (quad_) {
+        objects.push_back(quad_->getObject());
+      }
+    } else {
+      auto collect = [this, &objects](LineChunk & chunk, bool used) {
+          if (!used) {
+            return;
+          }
+          if (chunk.mesh) {
+            batch_count_ += chunk.mesh->vertex_count > 0 ? 1 : 0;
+            vertex_count_ += chunk.mesh->vertex_count;
+            index_count_ += chunk.mesh->index_count;
+            vertex_buffer_size_ += chunk.mesh->vertex_buffer_size;
+            index_buffer_size_ += chunk.mesh->index_buffer_size;
+          } else if (chunk.object) {
+            objects.push_back(chunk.object.get());
+          }
+        };
+      forEachChunk(params_, bands_[0], collect);
+      forEachChunk(params_, bands_[1], collect);
+      forEachChunk(params_, spokes_, collect);
+    }
+    for (Ogre::ManualObject * object : objects) {
+      for (size_t i = 0; i < object->getNumSections(); ++i) {
+        Ogre::RenderOperation * op = object->getSection(i)->getRenderOperation();
+        batch_count_ += op->vertexData->vertexCount > 0 ? 1 : 0;
+        vertex_count_ += op->vertexData->vertexCount;
+        vertex_buffer_size_ +=
+          op->vertexData->vertexCount * op->vertexData->vertexDeclaration->getVertexSize(0);
+        if (op->useIndexes) {
+          index_count_ += op->indexData->indexCount;
+          index_buffer_size_ +=
+            op->indexData->indexCount * op->indexData->indexBuffer->getIndexSize();
+        }
       }
     }
+  }
+
+  size_t PolarGrid::getVertexCount() const {return vertex_count_;}
+
+  size_t PolarGrid::getBatchCount() const {return batch_count_;}
+
+  size_t PolarGrid::getIndexCount() const {return index_count_;}
+
+  size_t PolarGrid::getVertexBufferSize() const {return vertex_buffer_size_;}
 
-    polar_grid_->end();
+  size_t PolarGrid::getIndexBufferSize() const {return index_buffer_size_;}
+
+  const PolarGridStats & PolarGrid::getStats() const {return stats_;}
+
+  bool PolarGrid::isDirty() const
+  {
+    return dirty_ != kDirtyNone ||
+           std::find(dirty_bands_.begin(), dirty_bands_.end(), true) != dirty_bands_.end();
   }
 
   void PolarGrid::setPosition(const Ogre::Vector3 & position) {scene_node_->setPosition(position);}
@@ -120,9 +675,45 @@ namespace polar_grid_rviz_plugins {
 
   void PolarGrid::setColor(float r, float g, float b, float a)
   {
-    color_ = Ogre::ColourValue(r, g, b, a);
-    rviz_rendering::MaterialManager::enableAlphaBlending(material_, color_.a);
-    draw();
+    Ogre::ColourValue color(r, g, b, a);
+    if (color == color_) {return;}
+    color_ = color;
+    applyColor();
+    if (quad_) {
+      quad_->getPass()->getFragmentProgramParameters()->setNamedConstant("color", color_);
+    }
+  }
+
+  void PolarGrid::applyColor()
+  {
+    if (share_geometry_ && (!shared_material_ || shared_color_ != color_)) {
+      shared_material_ = acquireMaterial(color_);
+      shared_color_ = color_;
+    }
+    for (int tier = 0; tier < 2; ++tier) {
+      // A tier at full opacity shares the material of its colour, a fading
+      // one needs its own.
+      Ogre::MaterialPtr material;
+      if (share_geometry_ && tier_fade_[tier] == 1.f) {
+        material = shared_material_->material;
+      } else {
+        material = own_materials_[tier];
+        float alpha = color_.a * tier_fade_[tier];
+        material->setSelfIllumination(color_.r, color_.g, color_.b);
+        material->setDiffuse(0.f, 0.f, 0.f, alpha);
+        rviz_rendering::MaterialManager::enableAlphaBlending(material, alpha);
+      }
+      if (material == tier_materials_[tier]) {continue;}
+      tier_materials_[tier] = material;
+      auto assign = [&material](LineChunk & chunk, bool /* used */) {
+          chunk.setMaterial(material);
+        };
+      forEachChunk(params_, bands_[tier], assign);
+      // Spokes are drawn with the material of the major circles.
+      if (tier == 0) {
+        forEachChunk(params_, spokes_, assign);
+      }
+    }
   }
 
   const Ogre::Vector3 & PolarGrid::getPosition() {return scene_node_->getPosition();}
@@ -133,50 +724,218 @@ namespace polar_grid_rviz_plugins {
 
   void PolarGrid::setMinRadius(float min_radius)
   {
-    min_radius_ = min_radius;
-    draw();
+    if (params_.min_radius == min_radius) {return;}
+    params_.min_radius = min_radius;
+    dirty_ |= kDirtyRings | kDirtySectors;
   }
 
   void PolarGrid::setRadiusStep(float radius_step)
   {
-    radius_step_ = radius_step;
-    draw();
+    if (params_.radius_step == radius_step) {return;}
+    params_.radius_step = radius_step;
+    dirty_ |= kDirtyRings | kDirtySectors;
   }
 
   void PolarGrid::setCirclesCount(int circles_count)
   {
-    circles_count_ = circles_count;
-    draw();
+    if (params_.circles_count == circles_count) {return;}
+    // Only the bands between the old and the new last circle change, and the
+    // spokes which end at the last circle, unless the bands are resized.
+    markRings(
+      std::min(params_.circles_count, circles_count),
+      std::max(params_.circles_count, circles_count));
+    int circles = bandCircles(params_);
+    params_.circles_count = circles_count;
+    if (bandCircles(params_) != circles) {
+      dirty_ |= kDirtyRings;
+    }
+    dirty_ |= kDirtySectors;
+    applyVisibility();
   }
 
   void PolarGrid::setSectors(bool sectors)
   {
-    sectors_ = sectors;
-    draw();
+    if (params_.sectors == sectors) {return;}
+    params_.sectors = sectors;
+    // The circles only change if the sectors restrict them to an arc.
+    if (params_.invert || params_.min_angle != -180.f || params_.max_angle != 180.f) {
+      dirty_ |= kDirtyRings;
+    }
+    dirty_ |= kDirtySectors;
+    applyVisibility();
   }
 
   void PolarGrid::setMinAngle(int min_angle)
   {
-    min_angle_ = min_angle;
-    draw();
+    if (params_.min_angle == min_angle) {return;}
+    params_.min_angle = min_angle;
+    dirty_ |= kDirtyRings | kDirtySectors;
   }
 
   void PolarGrid::setMaxAngle(int max_angle)
   {
-    max_angle_ = max_angle;
-    draw();
+    if (params_.max_angle == max_angle) {return;}
+    params_.max_angle = max_angle;
+    dirty_ |= kDirtyRings | kDirtySectors;
   }
 
   void PolarGrid::setSectorCount(int sector_count)
   {
-    sector_count_ = sector_count;
-    draw();
+    if (params_.sector_count == sector_count) {return;}
+    params_.sector_count = sector_count;
+    dirty_ |= kDirtySectors;
   }
 
   void PolarGrid::setInvert(bool invert)
   {
-    invert_ = invert;
-    draw();
+    if (params_.invert == invert) {return;}
+    params_.invert = invert;
+    dirty_ |= kDirtyRings | kDirtySectors;
+  }
+
+  void PolarGrid::setMajorEvery(int major_every)
+  {
+    if (params_.major_every == major_every) {return;}
+    params_.major_every = major_every;
+    dirty_ |= kDirtyRings;
+  }
+
+  void PolarGrid::setLodPixelSpacing(float lod_pixel_spacing)
+  {
+    if (lod_pixel_spacing_ == lod_pixel_spacing) {return;}
+    lod_pixel_spacing_ = lod_pixel_spacing;
+    if (lod_pixel_spacing_ <= 0.f) {
+      setTierFade(RingTier::kMajor, 1.f);
+      setTierFade(RingTier::kMinor, 1.f);
+    }
+  }
+
+  void PolarGrid::setTierFade(RingTier tier, float fade)
+  {
+    float & current = tier_fade_[static_cast < int > (tier)];
+    if (current == fade) {return;}
+    bool toggled = (current > 0.f) != (fade > 0.f);
+    current = fade;
+    applyColor();
+    if (toggled) {
+      applyVisibility();
+    }
+  }
+
+  bool PolarGrid::setLabels(bool labels)
+  {
+    labels_enabled_ = labels;
+    if (!labels) {
+      labels_.reset();
+      return true;
+    }
+    if (!labels_) {
+      labels_ = std::make_unique < PolarGridLabels > (
+        scene_manager_, scene_node_.get(), name_ + "Labels");
+      labels_->setColor(label_color_);
+      labels_->setCharHeight(label_size_);
+      labels_->setVisible(visible_);
+    }
+    return labels_->isSupported();
+  }
+
+  void PolarGrid::setLabelColor(float r, float g, float b, float a)
+  {
+    label_color_ = Ogre::ColourValue(r, g, b, a);
+    if (labels_) {
+      labels_->setColor(label_color_);
+    }
+  }
+
+  void PolarGrid::setLabelSize(float label_size)
+  {
+    label_size_ = label_size;
+    if (labels_) {
+      labels_->setCharHeight(label_size_);
+    }
+  }
+
+  void PolarGrid::setPixelTolerance(float pixel_tolerance)
+  {
+    if (pixel_tolerance_ == pixel_tolerance) {return;}
+    pixel_tolerance_ = pixel_tolerance;
+    params_.ring_levels.clear();
+    dirty_ |= kDirtyRings;
+  }
+
+  void PolarGrid::setCamera(const Ogre::Camera * camera)
+  {
+    updateLevelOfDetail(camera);
+    if (labels_) {
+      labels_->setParams(params_);
+      labels_->setMinorVisible(render_mode_ != RenderMode::kLines || tier_fade_[1] > 0.f);
+      labels_->update(camera);
+    }
+  }
+
+  void PolarGrid::updateLevelOfDetail(const Ogre::Camera * camera)
+  {
+    if (render_mode_ != RenderMode::kLines) {return;}
+    if (pixel_tolerance_ <= 0.f && lod_pixel_spacing_ <= 0.f) {return;}
+    if (!camera || !camera->getViewport()) {return;}
+    float height = static_cast < float > (camera->getViewport()->getActualHeight());
+    if (height <= 0.f) {return;}
+
+    // World size of one pixel is pixel_size * distance + pixel_offset, which
+    // covers both perspective and orthographic projections.
+    float pixel_size = 0.f, pixel_offset = 0.f;
+    if (camera->getProjectionType() == Ogre::PT_PERSPECTIVE) {
+      pixel_size = 2.f * Ogre::Math::Tan(camera->getFOVy() * 0.5f) / height;
+    } else {
+      pixel_offset = camera->getOrthoWindowHeight() / height;
+    }
+
+    Ogre::Vector3 eye = scene_node_->convertWorldToLocalPosition(camera->getDerivedPosition());
+    float planar = std::hypot(eye.x, eye.y);
+    float near_clip = camera->getNearClipDistance();
+
+    if (lod_pixel_spacing_ > 0.f) {
+      // Judge the spacing where the grid is closest to the camera, the part
+      // of the grid that shows the most detail.
+      float max_radius = params_.circles_count > 0 ?
+        ringRadius(params_, params_.circles_count - 1) : params_.min_radius;
+      float closest = std::clamp(planar, params_.min_radius, max_radius);
+      float distance = std::max(near_clip, std::hypot(eye.z, planar - closest));
+      float pixel = pixel_size * distance + pixel_offset;
+      float minor_spacing = params_.radius_step / pixel;
+      float major_spacing = minor_spacing * std::max(params_.major_every, 1);
+      // Fade a tier out while its spacing drops from twice the threshold to
+      // the threshold, then hide it.
+      auto fade = [this](float spacing) {
+          return std::clamp(spacing / lod_pixel_spacing_ - 1.f, 0.f, 1.f);
+        };
+      setTierFade(RingTier::kMajor, fade(major_spacing));
+      setTierFade(RingTier::kMinor, fade(minor_spacing));
+    }
+
+    if (pixel_tolerance_ <= 0.f) {return;}
+    std::vector < int > & levels = params_.ring_levels;
+    // New circles start below any level so that they are always assigned one.
+    levels.resize(params_.circles_count, 0);
+    for (int i = 0; i < params_.circles_count; ++i) {
+      float radius = ringRadius(params_, i);
+      float distance = std::max(near_clip, std::hypot(eye.z, planar - radius));
+      float error = pixel_tolerance_ * (pixel_size * distance + pixel_offset);
+      // Chord error of a segment spanning theta is r * (1 - cos(theta / 2)).
+      float theta = 2.f * std::acos(std::max(-1.f, 1.f - error / std::max(radius, 1e-6f)));
+      float segments = 2.f * Ogre::Math::PI / std::max(theta, 1e-6f);
+      int level = std::clamp(
+        static_cast < int > (std::ceil(std::log2(segments))), kMinRingLevel, kMaxRingLevel);
+      // Refine as soon as needed but only coarsen once the circle is two
+      // levels too fine, so small camera motions do not re-tessellate.
+      int & current = levels[i];
+      if (level > current || level < current - 1) {
+        if (current != level) {
+          markRings(i, i + 1);
+        }
+        current = level;
+      }
+    }
   }
 
   std::shared_ptr < Ogre::SceneNode > PolarGrid::getSceneNode() {
@@ -0,0 +1,210 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <algorithm>
+
+#include <OgreMaterialManager.h>
+
+#include <polar_grid_rviz_plugins/polar_grid_batch.hpp>
+#include <rviz_rendering/material_manager.hpp>
+
+namespace polar_grid_rviz_plugins {
+
+  namespace {
+
+  constexpr float kPositionTolerance = 1e-4f;
+  constexpr float kOrientationTolerance = 1e-4f;
+
+  }  // namespace
+
+  PolarGridBatch::PolarGridBatch(Ogre::SceneManager * scene_manager, Ogre::SceneNode * parent_node)
+  {
+    static int count = 0;
+    std::string name = "PolarGridBatch" + std::to_string(count++);
+    scene_manager_ = scene_manager;
+
+    if (!parent_node) {
+      parent_node = scene_manager->getRootSceneNode();
+    }
+    scene_node_ = std::shared_ptr < Ogre::SceneNode > (
+      parent_node->createChildSceneNode(), [scene_manager](Ogre::SceneNode * node) {
+        scene_manager->destroySceneNode(node);
+      });
+
+    // Same emissive-only material as PolarGrid, shared by every grid.
+    material_ = rviz_rendering::MaterialManager::createMaterialWithNoLighting(name + "Material");
+    material_->setLightingEnabled(true);
+    material_->setAmbient(Ogre::ColourValue::Black);
+
+    object_ = std::shared_ptr < Ogre::ManualObject > (
+      scene_manager_->createManualObject(name), [scene_manager](Ogre::ManualObject * object) {
+        scene_manager->destroyManualObject(object);
+      });
+    object_->setDynamic(true);
+    scene_node_->attachObject(object_.get());
+
+    dirty_ = true;
+    vertex_capacity_ = index_capacity_ = vertex_count_ = 0;
+    setColor(1.f, 1.f, 1.f, 1.f);
+  }
+
+  PolarGridBatch::~PolarGridBatch()
+  {
+    object_.reset();
+    Ogre::MaterialManager::getSingleton().remove(material_->getHandle());
+  }
+
+  void PolarGridBatch::setColor(float r, float g, float b, float a)
+  {
+    material_->setSelfIllumination(r, g, b);
+    material_->setDiffuse(0.f, 0.f, 0.f, a);
+    rviz_rendering::MaterialManager::enableAlphaBlending(material_, a);
+  }
+
+  void PolarGridBatch::setVisible(bool visible) {object_->setVisible(visible);}
+
+  void PolarGridBatch::resize(size_t count)
+  {
+    if (grids_.size() == count) {return;}
+    grids_.resize(count);
+    dirty_ = true;
+  }
+
+  size_t PolarGridBatch::size() const {return grids_.size();}
+
+  void PolarGridBatch::setParams(size_t grid, const PolarGridParams & params)
+  {
+    PolarGridParams & current = grids_[grid].params;
+    if (current.min_radius == params.min_radius && current.radius_step == params.radius_step &&
+      current.circles_count == params.circles_count && current.sectors == params.sectors &&
+      current.min_angle == params.min_angle && current.max_angle == params.max_angle &&
+      current.sector_count == params.sector_count && current.invert == params.invert)
+    {
+      return;
+    }
+    current = params;
+    // Batched grids have no level of detail, every circle is major and
+    // tessellated with fixed segments.
+    current.major_every = 0;
+    current.ring_levels.clear();
+    dirty_ = true;
+  }
+
+  void PolarGridBatch::setPose(
+    size_t grid, const Ogre::Vector3 & position, const Ogre::Quaternion & orientation)
+  {
+    Grid & current = grids_[grid];
+    if (current.position.positionEquals(position, kPositionTolerance) &&
+      current.orientation.equals(orientation, Ogre::Radian(kOrientationTolerance)))
+    {
+      return;
+    }
+    current.position = position;
+    current.orientation = orientation;
+    dirty_ |= current.visible;
+  }
+
+  void PolarGridBatch::setGridVisible(size_t grid, bool visible)
+  {
+    if (grids_[grid].visible == visible) {return;}
+    grids_[grid].visible = visible;
+    dirty_ = true;
+  }
+
+  bool PolarGridBatch::update()
+  {
+    if (!dirty_) {return false;}
+    dirty_ = false;
+
+    size_t vertices = 0, indices = 0;
+    for (const Grid & grid : grids_) {
+      if (!grid.visible) {continue;}
+      for (int i = 0; i < bandCount(grid.params); ++i) {
+        for (int j = 0; j < bandSlices(grid.params, i); ++j) {
+          size_t chunk_vertices = 0, chunk_indices = 0;
+          countBand(grid.params, i, j, RingTier::kMajor, chunk_vertices, chunk_indices);
+          vertices += chunk_vertices;
+          indices += chunk_indices;
+          countSpokes(grid.params, i, j, chunk_vertices, chunk_indices);
+          vertices += chunk_vertices;
+          indices += chunk_indices;
+        }
+      }
+    }
+
+    // Same high-water dynamic buffers as the chunks of PolarGrid.
+    if (vertices > vertex_capacity_ || indices > index_capacity_) {
+      vertex_capacity_ = std::max(vertex_capacity_, vertices + vertices / 2);
+      index_capacity_ = std::max(index_capacity_, indices + indices / 2);
+    }
+    object_->estimateVertexCount(vertex_capacity_);
+    object_->estimateIndexCount(index_capacity_);
+    if (object_->getNumSections() == 0) {
+      object_->begin(material_->getName(), Ogre::RenderOperation::OT_LINE_LIST, "rviz_rendering");
+    } else {
+      object_->beginUpdate(0);
+    }
+
+    bounds_.setNull();
+    uint32_t base = 0;
+    for (const Grid & grid : grids_) {
+      if (!grid.visible) {continue;}
+      for (int i = 0; i < bandCount(grid.params); ++i) {
+        for (int j = 0; j < bandSlices(grid.params, i); ++j) {
+          buildBand(grid.params, i, j, RingTier::kMajor, geometry_);
+          append(grid, geometry_, base);
+          base += static_cast < uint32_t > (geometry_.positions.size() / 3);
+          buildSpokes(grid.params, i, j, geometry_);
+          append(grid, geometry_, base);
+          base += static_cast < uint32_t > (geometry_.positions.size() / 3);
+        }
+      }
+    }
+    object_->end();
+    if (!bounds_.isNull()) {
+      object_->setBoundingBox(bounds_);
+    }
+    scene_node_->needUpdate();
+    vertex_count_ = vertices;
+    return true;
+  }
+
+  void PolarGridBatch::append(const Grid & grid, const PolarGridGeometry & geometry, uint32_t base)
+  {
+    // Bake the pose of the grid into its vertices.
+    const float * p = geometry.positions.data();
+    for (size_t i = 0; i < geometry.positions.size(); i += 3, p += 3) {
+      Ogre::Vector3 position = grid.position + grid.orientation * Ogre::Vector3(p[0], p[1], p[2]);
+      object_->position(position);
+      bounds_.merge(position);
+    }
+    for (uint32_t index : geometry.indices) {
+      object_->index(base + index);
+    }
+  }
+
+  size_t PolarGridBatch::getVertexCount() const {return vertex_count_;}
+
+  std::shared_ptr < Ogre::SceneNode > PolarGridBatch::getSceneNode() {return scene_node_;}
+
+}  // namespace polar_grid_rviz_plugins
@@ -0,0 +1,149 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+#include <OgreManualObject.h>
+#include <OgreMaterialManager.h>
+#include <OgreMeshManager.h>
+#include <OgreSubMesh.h>
+
+#include <polar_grid_rviz_plugins/polar_grid_cache.hpp>
+#include <rviz_rendering/material_manager.hpp>
+
+namespace polar_grid_rviz_plugins {
+
+  namespace {
+
+  std::mutex mesh_mutex;
+  std::unordered_map < std::string, std::weak_ptr < const SharedMesh >> meshes;
+  std::map < uint32_t, std::weak_ptr < const SharedMaterial >> materials;
+
+  // Drops the entries nobody holds anymore.
+  template<typename Map>
+  void sweep(Map & map)
+  {
+    for (auto it = map.begin(); it != map.end(); ) {
+      it = it->second.expired() ? map.erase(it) : std::next(it);
+    }
+  }
+
+  }  // namespace
+
+  std::shared_ptr < const SharedMesh > acquireMesh(const PolarGridGeometry & geometry)
+  {
+    static int count = 0;
+    {
+      std::lock_guard < std::mutex > lock(mesh_mutex);
+      auto it = meshes.find(geometry.key);
+      if (it != meshes.end()) {
+        if (auto mesh = it->second.lock()) {
+          return mesh;
+        }
+      }
+    }
+    if (geometry.cached || geometry.positions.empty()) {
+      return nullptr;
+    }
+
+    // Shared chunks never change, so they go into static buffers through a
+    // temporary manual object. Holders set their own material.
+    std::string name = "PolarGridMesh" + std::to_string(count++);
+    Ogre::ManualObject object(name);
+    size_t vertices = geometry.positions.size() / 3;
+    object.estimateVertexCount(vertices);
+    object.estimateIndexCount(geometry.indices.size());
+    object.begin("BaseWhiteNoLighting", Ogre::RenderOperation::OT_LINE_LIST, "rviz_rendering");
+    const float * p = geometry.positions.data();
+    for (size_t i = 0; i < vertices; ++i, p += 3) {
+      object.position(p[0], p[1], p[2]);
+    }
+    for (uint32_t index : geometry.indices) {
+      object.index(index);
+    }
+    object.end();
+
+    auto shared = std::shared_ptr < SharedMesh > (
+      new SharedMesh, [](SharedMesh * mesh) {
+        Ogre::MeshManager::getSingleton().remove(mesh->mesh->getHandle());
+        delete mesh;
+      });
+    shared->mesh = object.convertToMesh(name, "rviz_rendering");
+    for (size_t i = 0; i < shared->mesh->getNumSubMeshes(); ++i) {
+      const Ogre::SubMesh * submesh = shared->mesh->getSubMesh(i);
+      shared->vertex_count += submesh->vertexData->vertexCount;
+      shared->vertex_buffer_size +=
+        submesh->vertexData->vertexCount * submesh->vertexData->vertexDeclaration->getVertexSize(0);
+      shared->index_count += submesh->indexData->indexCount;
+      shared->index_buffer_size +=
+        submesh->indexData->indexCount * submesh->indexData->indexBuffer->getIndexSize();
+    }
+
+    std::lock_guard < std::mutex > lock(mesh_mutex);
+    sweep(meshes);
+    meshes[geometry.key] = shared;
+    return shared;
+  }
+
+  bool isMeshCached(const std::string & key)
+  {
+    std::lock_guard < std::mutex > lock(mesh_mutex);
+    auto it = meshes.find(key);
+    return it != meshes.end() && !it->second.expired();
+  }
+
+  std::shared_ptr < const SharedMaterial > acquireMaterial(const Ogre::ColourValue & color)
+  {
+    static int count = 0;
+    uint32_t key = color.saturateCopy().getAsRGBA();
+    auto it = materials.find(key);
+    if (it != materials.end()) {
+      if (auto material = it->second.lock()) {
+        return material;
+      }
+    }
+
+    // Same emissive-only material as the private ones of PolarGrid.
+    auto shared = std::shared_ptr < SharedMaterial > (
+      new SharedMaterial, [](SharedMaterial * material) {
+        Ogre::MaterialManager::getSingleton().remove(material->material->getHandle());
+        delete material;
+      });
+    Ogre::MaterialPtr material = rviz_rendering::MaterialManager::createMaterialWithNoLighting(
+      "PolarGridSharedMaterial" + std::to_string(count++));
+    material->setLightingEnabled(true);
+    material->setAmbient(Ogre::ColourValue::Black);
+    material->setSelfIllumination(color.r, color.g, color.b);
+    material->setDiffuse(0.f, 0.f, 0.f, color.a);
+    rviz_rendering::MaterialManager::enableAlphaBlending(material, color.a);
+    shared->material = material;
+
+    sweep(materials);
+    materials[key] = shared;
+    return shared;
+  }
+
+}  // namespace polar_grid_rviz_plugins
@@ -21,9 +21,20 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  */
+#include <cmath>
+#include <exception>
+
+#include <OgreTextureManager.h>
+
+#include <geometry_msgs/msg/pose_stamped.hpp>
 #include <polar_grid_rviz_plugins/polar_grid_display.hpp>
 #include <rviz_common/display_context.hpp>
+#include <rviz_common/frame_manager_iface.hpp>
 #include <rviz_common/logging.hpp>
+#include <rviz_common/properties/status_property.hpp>
+#include <rviz_common/transformation/frame_transformer.hpp>
+#include <rviz_common/view_controller.hpp>
+#include <rviz_common/view_manager.hpp>
 #include <rviz_rendering/material_manager.hpp>
 
 namespace polar_grid_rviz_plugins {
@@ -32,7 +43,8 @@ namespace polar_grid_rviz_plugins {
   {
     frame_property_ = std::make_unique < rviz_common::properties::TfFrameProperty > (
       "Reference Frame", rviz_common::properties::TfFrameProperty::FIXED_FRAME_STRING,
-      "The TF frame this polar grid will use for its origin.", this, nullptr, true);
+      "The TF frame this polar grid will use for its origin.", this,
+      SLOT(updateReferenceFrame()), true);
 
     color_property_ = std::make_unique < rviz_common::properties::ColorProperty > (
       "Color", Qt::gray, "The color of the circles.", this, SLOT(updateColor()));
@@ -55,6 +67,11 @@ namespace polar_grid_rviz_plugins {
       "Circles Count", 5, "The number of circles to draw.", this, SLOT(updateCirclesCount()));
     circles_count_property_->setMin(0);
 
+    major_every_property_ = std::make_unique < rviz_common::properties::IntProperty > (
+      "Major Circles Every", 5, "Every n-th circle is a major circle, 1 makes all circles major.",
+      this, SLOT(updateMajorEvery()));
+    major_every_property_->setMin(1);
+
     plane_property_ = std::make_unique < rviz_common::properties::EnumProperty > (
       "Plane", "XY", "The plane to draw the polar grid along.", this, SLOT(updatePlane()));
     plane_property_->addOption("XY", static_cast < int > (Plane::kXY));
@@ -90,7 +107,142 @@ namespace polar_grid_rviz_plugins {
       "Offset", Ogre::Vector3::ZERO, "The origin of the polar grid in meters.", this,
       SLOT(updateOffset()));
 
-    // TODO(HuaTsai): show texts and their color/size, pending
+    pixel_tolerance_property_ = std::make_unique < rviz_common::properties::FloatProperty > (
+      "Pixel Tolerance", 0.5f,
+      "The maximum chord error of the circles in pixels, 0 uses fixed 1 degree segments.", this,
+      SLOT(updatePixelTolerance()));
+    pixel_tolerance_property_->setMin(0.f);
+
+    lod_pixel_spacing_property_ = std::make_unique < rviz_common::properties::FloatProperty > (
+      "LOD Pixel Spacing", 3.f,
+      "Minor and then major circles fade out when closer than this on screen in pixels, 0 "
+      "always draws every circle.", this, SLOT(updateLodPixelSpacing()));
+    lod_pixel_spacing_property_->setMin(0.f);
+
+    render_mode_property_ = std::make_unique < rviz_common::properties::EnumProperty > (
+      "Render Mode", "Lines",
+      "Lines regenerates line geometry on changes, Shader draws the grid in a fragment program.",
+      this, SLOT(updateRenderMode()));
+    render_mode_property_->addOption("Lines", static_cast < int > (PolarGrid::RenderMode::kLines));
+    render_mode_property_->addOption(
+      "Shader", static_cast < int > (PolarGrid::RenderMode::kProcedural));
+
+    share_geometry_property_ = std::make_unique < rviz_common::properties::BoolProperty > (
+      "Share Geometry", false,
+      "Identical circles and spokes of all polar grids are uploaded once and shared. Off gives "
+      "this grid its own buffers, which re-tessellate and change colour faster.", this,
+      SLOT(updateShareGeometry()));
+
+    release_time_property_ = std::make_unique < rviz_common::properties::FloatProperty > (
+      "Release Time", 30.f,
+      "Seconds the grid keeps its buffers while disabled or without a transform before they are "
+      "freed, 0 frees them right away.", this);
+    release_time_property_->setMin(0.f);
+
+    release_timer_.setSingleShot(true);
+    connect(&release_timer_, SIGNAL(timeout()), this, SLOT(releaseResources()));
+
+    labels_property_ = std::make_unique < rviz_common::properties::BoolProperty > (
+      "Labels", false, "Range labels on the circles and bearing labels on the spokes.", this,
+      SLOT(updateLabels()));
+    labels_property_->setDisableChildrenIfFalse(true);
+
+    label_color_property_ = std::make_unique < rviz_common::properties::ColorProperty > (
+      "Label Color", Qt::white, "The color of the labels.", labels_property_.get(),
+      SLOT(updateLabelColor()), this);
+
+    label_size_property_ = std::make_unique < rviz_common::properties::FloatProperty > (
+      "Label Size", 0.3f, "The height of the label characters in meters.",
+      labels_property_.get(), SLOT(updateLabelSize()), this);
+    label_size_property_->setMin(0.01f);
+
+    parameter_topic_property_ = std::make_unique < rviz_common::properties::RosTopicProperty > (
+      "Parameter Topic", "",
+      QString::fromStdString(
+        rosidl_generator_traits::name < std_msgs::msg::Float32MultiArray > ()),
+      "Optional topic of [min radius, radius step, circles count, min angle, max angle] that "
+      "overrides the matching properties, empty disables it.", this,
+      SLOT(updateParameterTopic()));
+
+    change_threshold_property_ = std::make_unique < rviz_common::properties::FloatProperty > (
+      "Change Threshold", 0.01f,
+      "The smallest change of a topic parameter in meters or degrees that regenerates the grid.",
+      parameter_topic_property_.get());
+    change_threshold_property_->setMin(0.f);
+
+    metrics_topic_property_ = std::make_unique < rviz_common::properties::RosTopicProperty > (
+      "Metrics Topic", "",
+      QString::fromStdString(
+        rosidl_generator_traits::name < diagnostic_msgs::msg::DiagnosticArray > ()),
+      "Optional topic the update time and the rebuild counters of this grid are published on "
+      "once per second, empty disables it.", this, SLOT(updateMetricsTopic()));
+
+    heatmap_property_ = std::make_unique < rviz_common::properties::BoolProperty > (
+      "Heatmap", false, "Filled cells coloured from range-azimuth arrays.", this,
+      SLOT(updateHeatmap()));
+    heatmap_property_->setDisableChildrenIfFalse(true);
+
+    heatmap_topic_property_ = std::make_unique < rviz_common::properties::RosTopicProperty > (
+      "Heatmap Topic", "",
+      QString::fromStdString(rosidl_generator_traits::name < sensor_msgs::msg::Image > ()),
+      "Images whose rows are range bins from the minimum radius outwards and columns azimuth "
+      "bins over the sector arc, in mono8, mono16 or 32FC1.", heatmap_property_.get(),
+      SLOT(updateHeatmapTopic()), this);
+
+    heatmap_min_value_property_ = std::make_unique < rviz_common::properties::FloatProperty > (
+      "Minimum Value", 0.f, "The value at the low end of the color map.",
+      heatmap_property_.get(), SLOT(updateHeatmapStyle()), this);
+
+    heatmap_max_value_property_ = std::make_unique < rviz_common::properties::FloatProperty > (
+      "Maximum Value", 1.f, "The value at the high end of the color map.",
+      heatmap_property_.get(), SLOT(updateHeatmapStyle()), this);
+
+    heatmap_color_map_property_ = std::make_unique < rviz_common::properties::EnumProperty > (
+      "Color Map", "Turbo", "The color map of the cells.", heatmap_property_.get(),
+      SLOT(updateHeatmapStyle()), this);
+    heatmap_color_map_property_->addOption(
+      "Turbo", static_cast < int > (PolarHeatmap::ColorMap::kTurbo));
+    heatmap_color_map_property_->addOption(
+      "Grayscale", static_cast < int > (PolarHeatmap::ColorMap::kGrayscale));
+
+    heatmap_alpha_property_ = std::make_unique < rviz_common::properties::FloatProperty > (
+      "Heatmap Alpha", 0.8f, "The amount of transparency to apply to the cells.",
+      heatmap_property_.get(), SLOT(updateHeatmapStyle()), this);
+    heatmap_alpha_property_->setMin(0.f);
+    heatmap_alpha_property_->setMax(1.f);
+
+    sweep_property_ = std::make_unique < rviz_common::properties::BoolProperty > (
+      "Sweep", false, "A turning radar sweep with a fading trail over the grid.", this,
+      SLOT(updateSweep()));
+    sweep_property_->setDisableChildrenIfFalse(true);
+
+    sweep_color_property_ = std::make_unique < rviz_common::properties::ColorProperty > (
+      "Sweep Color", Qt::green, "The color of the sweep.", sweep_property_.get(),
+      SLOT(updateSweepStyle()), this);
+
+    sweep_alpha_property_ = std::make_unique < rviz_common::properties::FloatProperty > (
+      "Sweep Alpha", 0.5f, "The transparency of the leading edge, the trail fades from it.",
+      sweep_property_.get(), SLOT(updateSweepStyle()), this);
+    sweep_alpha_property_->setMin(0.f);
+    sweep_alpha_property_->setMax(1.f);
+
+    sweep_rate_property_ = std::make_unique < rviz_common::properties::FloatProperty > (
+      "Sweep Rate", 90.f,
+      "The turn rate in degrees per second, negative turns clockwise. The sign also sets the "
+      "side of the trail when following the azimuth topic.", sweep_property_.get(),
+      SLOT(updateSweepStyle()), this);
+
+    sweep_trail_property_ = std::make_unique < rviz_common::properties::FloatProperty > (
+      "Trail Angle", 60.f, "The angle the trail covers behind the leading edge in degrees.",
+      sweep_property_.get(), SLOT(updateSweepStyle()), this);
+    sweep_trail_property_->setMin(0.f);
+    sweep_trail_property_->setMax(360.f);
+
+    sweep_topic_property_ = std::make_unique < rviz_common::properties::RosTopicProperty > (
+      "Azimuth Topic", "",
+      QString::fromStdString(rosidl_generator_traits::name < std_msgs::msg::Float32 > ()),
+      "Optional topic of the bearing of the leading edge in radians, which then replaces the "
+      "sweep rate. Empty disables it.", sweep_property_.get(), SLOT(updateSweepTopic()), this);
   }
 
   void PolarGridDisplay::onInitialize()
@@ -98,6 +250,10 @@ namespace polar_grid_rviz_plugins {
     Display::onInitialize();
 
     frame_property_->setFrameManager(context_->getFrameManager());
+    parameter_topic_property_->initialize(context_->getRosNodeAbstraction());
+    heatmap_topic_property_->initialize(context_->getRosNodeAbstraction());
+    sweep_topic_property_->initialize(context_->getRosNodeAbstraction());
+    metrics_topic_property_->initialize(context_->getRosNodeAbstraction());
 
     polar_grid_ = std::make_unique < PolarGrid > (scene_manager_, scene_node_);
 
@@ -105,35 +261,580 @@ namespace polar_grid_rviz_plugins {
     updateMinRadius();
     updateRadiusStep();
     updateCirclesCount();
+    updateMajorEvery();
     updatePlane();
     updateSectors();
     updateMinAngle();
     updateMaxAngle();
     updateSectorCount();
     updateInvert();
+    updatePixelTolerance();
+    updateLodPixelSpacing();
+    updateRenderMode();
+    updateShareGeometry();
+    updateLabelColor();
+    updateLabelSize();
+    updateLabels();
+    updateHeatmap();
+    updateSweep();
+    updateMetricsTopic();
   }
 
-  void PolarGridDisplay::update(float /* dt */, float /* ros_dt */)
+  void PolarGridDisplay::onEnable()
   {
-    std::string frame = frame_property_->getFrame().toStdString();
+    // Geometry is only built by update(), which rviz does not call for
+    // disabled displays, so grids loaded disabled stay empty until here.
+    cancelRelease();
+    // Static frames may have moved while the display was off.
+    invalidateTransform();
+    subscribe();
+    if (heatmap_property_->getBool() && !heatmap_) {
+      updateHeatmap();
+    } else {
+      subscribeHeatmap();
+    }
+    subscribeSweep();
+    // Display::onEnableChanged() shows the scene node recursively, which
+    // also shows the chunks and quads the grid keeps hidden.
+    polar_grid_->applyVisibility();
+    if (heatmap_) {
+      heatmap_->setVisible(transform_ok_ == true);
+    }
+    if (sweep_) {
+      sweep_->setVisible(transform_ok_ == true);
+    }
+  }
+
+  void PolarGridDisplay::onDisable()
+  {
+    unsubscribe();
+    unsubscribeHeatmap();
+    unsubscribeSweep();
+    scheduleRelease();
+  }
+
+  void PolarGridDisplay::scheduleRelease()
+  {
+    if (release_timer_.isActive()) {return;}
+    release_timer_.start(static_cast < int > (release_time_property_->getFloat() * 1000.f));
+  }
+
+  void PolarGridDisplay::cancelRelease() {release_timer_.stop();}
+
+  void PolarGridDisplay::releaseResources()
+  {
+    if (!polar_grid_) {return;}
+    polar_grid_->releaseGeometry();
+    // The heatmap texture only goes while disabled, when nothing feeds it.
+    // onEnable() creates it again.
+    if (!isEnabled() && heatmap_) {
+      releaseHeatmap();
+    }
+    setStatus(rviz_common::properties::StatusProperty::Ok, "Geometry", "Released");
+  }
+
+  void PolarGridDisplay::updateHeatmap()
+  {
+    unsubscribeHeatmap();
+    if (!heatmap_property_->getBool()) {
+      releaseHeatmap();
+      context_->queueRender();
+      return;
+    }
+    if (!heatmap_) {
+      heatmap_ = std::make_unique < PolarHeatmap > (
+        scene_manager_, polar_grid_->getSceneNode().get());
+      updateHeatmapStyle();
+    }
+    if (!heatmap_->isSupported()) {
+      setStatus(
+        rviz_common::properties::StatusProperty::Warn, "Heatmap",
+        "The heatmap material is not available.");
+      return;
+    }
+    if (isEnabled()) {
+      subscribeHeatmap();
+    }
+    context_->queueRender();
+  }
+
+  void PolarGridDisplay::releaseHeatmap()
+  {
+    deleteStatus("Heatmap");
+    if (!heatmap_) {return;}
+    std::string texture = heatmap_->getTextureName();
+    heatmap_.reset();
+    if (!texture.empty() &&
+      Ogre::TextureManager::getSingleton().resourceExists(texture, "rviz_rendering"))
+    {
+      RVIZ_COMMON_LOG_ERROR_STREAM("Heatmap texture " << texture << " outlived its heatmap.");
+    }
+  }
+
+  void PolarGridDisplay::updateHeatmapTopic()
+  {
+    unsubscribeHeatmap();
+    if (isEnabled()) {
+      subscribeHeatmap();
+    }
+    context_->queueRender();
+  }
+
+  void PolarGridDisplay::updateHeatmapStyle()
+  {
+    if (!heatmap_) {return;}
+    heatmap_->setValueRange(
+      heatmap_min_value_property_->getFloat(), heatmap_max_value_property_->getFloat());
+    heatmap_->setColorMap(
+      static_cast < PolarHeatmap::ColorMap > (heatmap_color_map_property_->getOptionInt()));
+    heatmap_->setAlpha(heatmap_alpha_property_->getFloat());
+    context_->queueRender();
+  }
+
+  void PolarGridDisplay::subscribeHeatmap()
+  {
+    std::string topic = heatmap_topic_property_->getTopicStd();
+    if (!heatmap_ || !heatmap_->isSupported() || topic.empty()) {return;}
+    try {
+      // Take the messages by unique pointer, so that they reach the upload
+      // without a copy.
+      heatmap_subscription_ = context_->getRosNodeAbstraction().lock()->get_raw_node()
+        ->create_subscription < sensor_msgs::msg::Image > (
+        topic, rclcpp::SensorDataQoS(),
+        [this](std::unique_ptr < sensor_msgs::msg::Image > image) {
+          heatmap_images_.store(std::move(image));
+        });
+    } catch (const std::exception & e) {
+      setStatus(
+        rviz_common::properties::StatusProperty::Error, "Heatmap",
+        QString("Error subscribing: ") + e.what());
+      return;
+    }
+    setStatus(rviz_common::properties::StatusProperty::Warn, "Heatmap", "No message");
+  }
+
+  void PolarGridDisplay::unsubscribeHeatmap()
+  {
+    heatmap_subscription_.reset();
+    heatmap_images_.take();
+  }
+
+  void PolarGridDisplay::uploadHeatmap()
+  {
+    if (!heatmap_) {return;}
+    heatmap_->setParams(polar_grid_->getParams());
+    heatmap_->setVisible(transform_ok_ == true);
+    std::unique_ptr < sensor_msgs::msg::Image > image = heatmap_images_.take();
+    if (!image) {return;}
+    std::string error;
+    if (heatmap_->upload(*image, error)) {
+      setStatus(
+        rviz_common::properties::StatusProperty::Ok, "Heatmap",
+        QString("%1 x %2 cells").arg(image->height).arg(image->width));
+    } else {
+      setStatus(
+        rviz_common::properties::StatusProperty::Error, "Heatmap", QString::fromStdString(error));
+    }
+  }
+
+  void PolarGridDisplay::updateSweep()
+  {
+    unsubscribeSweep();
+    if (!sweep_property_->getBool()) {
+      sweep_.reset();
+      deleteStatus("Sweep");
+      context_->queueRender();
+      return;
+    }
+    if (!sweep_) {
+      sweep_ = std::make_unique < PolarSweep > (scene_manager_, polar_grid_->getSceneNode().get());
+      sweep_->setParams(polar_grid_->getParams());
+      sweep_time_ = std::chrono::steady_clock::now();
+      updateSweepStyle();
+    }
+    if (!sweep_->isSupported()) {
+      setStatus(
+        rviz_common::properties::StatusProperty::Warn, "Sweep",
+        "The sweep material is not available.");
+      return;
+    }
+    if (isEnabled()) {
+      subscribeSweep();
+    }
+    context_->queueRender();
+  }
+
+  void PolarGridDisplay::updateSweepTopic()
+  {
+    unsubscribeSweep();
+    if (isEnabled()) {
+      subscribeSweep();
+    }
+    context_->queueRender();
+  }
+
+  void PolarGridDisplay::updateSweepStyle()
+  {
+    if (!sweep_) {return;}
+    Ogre::ColourValue color = sweep_color_property_->getOgreColor();
+    color.a = sweep_alpha_property_->getFloat();
+    sweep_->setColor(color);
+    sweep_->setTrail(sweep_trail_property_->getFloat(), sweep_rate_property_->getFloat() >= 0.f);
+    context_->queueRender();
+  }
+
+  void PolarGridDisplay::subscribeSweep()
+  {
+    std::string topic = sweep_topic_property_->getTopicStd();
+    if (!sweep_ || !sweep_->isSupported() || topic.empty()) {return;}
+    try {
+      sweep_subscription_ = context_->getRosNodeAbstraction().lock()->get_raw_node()
+        ->create_subscription < std_msgs::msg::Float32 > (
+        topic, rclcpp::SensorDataQoS(),
+        [this](std::unique_ptr < std_msgs::msg::Float32 > azimuth) {
+          sweep_azimuths_.store(std::move(azimuth));
+        });
+    } catch (const std::exception & e) {
+      setStatus(
+        rviz_common::properties::StatusProperty::Error, "Sweep",
+        QString("Error subscribing: ") + e.what());
+      return;
+    }
+    deleteStatus("Sweep");
+  }
+
+  void PolarGridDisplay::unsubscribeSweep()
+  {
+    sweep_subscription_.reset();
+    sweep_azimuths_.take();
+  }
+
+  void PolarGridDisplay::moveSweep()
+  {
+    if (!sweep_) {return;}
+    // Follow the params even while the grid is hidden or still building.
+    sweep_->setParams(polar_grid_->getParams());
+    sweep_->setVisible(transform_ok_ == true);
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration < double > (now - sweep_time_).count();
+    sweep_time_ = now;
+    if (sweep_subscription_) {
+      // Hold the last bearing until the next message.
+      if (std::unique_ptr < std_msgs::msg::Float32 > azimuth = sweep_azimuths_.take()) {
+        sweep_angle_ = azimuth->data * 180.0 / M_PI;
+      }
+    } else {
+      sweep_angle_ = std::fmod(sweep_angle_ + sweep_rate_property_->getFloat() * seconds, 360.0);
+    }
+    // The wedge and its trail are computed by the fragment program, so the
+    // angle is the only thing that changes per frame.
+    sweep_->setAngle(static_cast < float > (sweep_angle_));
+    context_->queueRender();
+  }
+
+  void PolarGridDisplay::updateParameterTopic()
+  {
+    unsubscribe();
+    if (isEnabled()) {
+      subscribe();
+    }
+    context_->queueRender();
+  }
+
+  void PolarGridDisplay::subscribe()
+  {
+    std::string topic = parameter_topic_property_->getTopicStd();
+    if (topic.empty()) {return;}
+    try {
+      parameter_subscription_ = context_->getRosNodeAbstraction().lock()->get_raw_node()
+        ->create_subscription < std_msgs::msg::Float32MultiArray > (
+        topic, rclcpp::QoS(1),
+        [this](std_msgs::msg::Float32MultiArray::ConstSharedPtr message) {
+          onParameters(*message);
+        });
+    } catch (const std::exception & e) {
+      setStatus(
+        rviz_common::properties::StatusProperty::Error, "Parameter Topic",
+        QString("Error subscribing: ") + e.what());
+      return;
+    }
+    setStatus(rviz_common::properties::StatusProperty::Warn, "Parameter Topic", "No message");
+    // The topic owns these parameters while subscribed.
+    min_radius_property_->setReadOnly(true);
+    radius_step_property_->setReadOnly(true);
+    circles_count_property_->setReadOnly(true);
+    min_angle_property_->setReadOnly(true);
+    max_angle_property_->setReadOnly(true);
+  }
+
+  void PolarGridDisplay::unsubscribe()
+  {
+    if (!parameter_subscription_) {return;}
+    parameter_subscription_.reset();
+    live_params_.take();
+    deleteStatus("Parameter Topic");
+    min_radius_property_->setReadOnly(false);
+    radius_step_property_->setReadOnly(false);
+    circles_count_property_->setReadOnly(false);
+    min_angle_property_->setReadOnly(false);
+    max_angle_property_->setReadOnly(false);
+    // Go back to the property values.
+    if (applied_params_) {
+      applied_params_.reset();
+      updateMinRadius();
+      updateRadiusStep();
+      updateCirclesCount();
+      updateMinAngle();
+      updateMaxAngle();
+    }
+  }
+
+  void PolarGridDisplay::onParameters(const std_msgs::msg::Float32MultiArray & message)
+  {
+    if (message.data.size() < 5) {return;}
+    auto params = std::make_unique < LiveParams > ();
+    params->min_radius = message.data[0];
+    params->radius_step = message.data[1];
+    params->circles_count = static_cast < int > (std::lround(message.data[2]));
+    params->min_angle = message.data[3];
+    params->max_angle = message.data[4];
+    // Messages arriving within one frame replace each other, only the latest
+    // one reaches the render thread.
+    live_params_.store(std::move(params));
+  }
+
+  void PolarGridDisplay::applyLiveParams()
+  {
+    std::unique_ptr < LiveParams > params = live_params_.take();
+    if (!params) {return;}
+    if (!(params->min_radius >= 0.f) || !(params->radius_step > 0.f) ||
+      params->circles_count < 0 || !(params->min_angle >= -180.f) ||
+      !(params->max_angle <= 180.f) ||
+      std::lround(params->min_angle) >= std::lround(params->max_angle))
+    {
+      setStatus(
+        rviz_common::properties::StatusProperty::Warn, "Parameter Topic",
+        "Ignoring invalid parameters.");
+      return;
+    }
+    setStatus(rviz_common::properties::StatusProperty::Ok, "Parameter Topic", "Receiving");
+
+    // Only values that moved past the threshold reach the grid, so sensor
+    // jitter does not regenerate the geometry every frame.
+    float threshold = change_threshold_property_->getFloat();
+    auto moved = [threshold](float applied, float value) {
+        return std::abs(value - applied) >= threshold;
+      };
+    bool first = !applied_params_;
+    LiveParams & applied = first ? applied_params_.emplace(*params) : *applied_params_;
+    if (first || moved(applied.min_radius, params->min_radius)) {
+      applied.min_radius = params->min_radius;
+      polar_grid_->setMinRadius(applied.min_radius);
+    }
+    if (first || moved(applied.radius_step, params->radius_step)) {
+      applied.radius_step = params->radius_step;
+      polar_grid_->setRadiusStep(applied.radius_step);
+    }
+    if (first || applied.circles_count != params->circles_count) {
+      applied.circles_count = params->circles_count;
+      polar_grid_->setCirclesCount(applied.circles_count);
+    }
+    if (first || moved(applied.min_angle, params->min_angle) ||
+      moved(applied.max_angle, params->max_angle))
+    {
+      applied.min_angle = params->min_angle;
+      applied.max_angle = params->max_angle;
+      polar_grid_->setMinAngle(static_cast < int > (std::lround(applied.min_angle)));
+      polar_grid_->setMaxAngle(static_cast < int > (std::lround(applied.max_angle)));
+    }
+  }
+
+  void PolarGridDisplay::reset()
+  {
+    Display::reset();
+    invalidateTransform();
+  }
+
+  void PolarGridDisplay::fixedFrameChanged()
+  {
+    Display::fixedFrameChanged();
+    invalidateTransform();
+  }
+
+  void PolarGridDisplay::invalidateTransform()
+  {
+    static_frame_ = false;
+    static_checked_ = false;
+    transform_ok_.reset();
+  }
+
+  void PolarGridDisplay::updateTransform()
+  {
+    // A static frame keeps the pose it was resolved with until the fixed or
+    // the reference frame changes.
+    if (static_frame_) {return;}
 
-#if (defined(ROS_DISTRO_GALACTIC))
+    std::string frame = frame_property_->getFrame().toStdString();
     Ogre::Vector3 position;
     Ogre::Quaternion orientation;
-    if (context_->getFrameManager()->getTransform(frame, position, orientation)) {
+    if (!context_->getFrameManager()->getTransform(frame, position, orientation)) {
+      if (transform_ok_ != false) {
+        setMissingTransformToFixedFrame(frame);
+        polar_grid_->setVisible(false);
+        transform_ok_ = false;
+        scheduleRelease();
+      }
+      return;
+    }
+
+    // Only touch the scene node when the pose actually moved.
+    if (transform_ok_ != true || position != position_ || orientation != orientation_) {
       scene_node_->setPosition(position);
       scene_node_->setOrientation(orientation);
-#else
-    if (updateFrame(frame)) {
-#endif
+      position_ = position;
+      orientation_ = orientation;
+    }
+    if (transform_ok_ != true) {
       setTransformOk();
-      polar_grid_->getSceneNode()->setVisible(true);
-    } else {
-      setMissingTransformToFixedFrame(frame);
-      polar_grid_->getSceneNode()->setVisible(false);
+      polar_grid_->setVisible(true);
+      transform_ok_ = true;
+      cancelRelease();
+    }
+
+    if (!static_checked_) {
+      static_checked_ = true;
+      static_frame_ = isStaticFrame(frame);
+    }
+  }
+
+  bool PolarGridDisplay::isStaticFrame(const std::string & frame) const
+  {
+    // tf2 stamps a lookup at time zero with zero only if every transform of
+    // the chain to the fixed frame is static.
+    geometry_msgs::msg::PoseStamped pose;
+    pose.header.frame_id = frame;
+    pose.pose.orientation.w = 1.0;
+    try {
+      geometry_msgs::msg::PoseStamped fixed =
+        context_->getFrameManager()->getTransformer()->transform(
+        pose, context_->getFixedFrame().toStdString());
+      return fixed.header.stamp.sec == 0 && fixed.header.stamp.nanosec == 0;
+    } catch (const std::exception &) {
+      return false;
+    }
+  }
+
+  void PolarGridDisplay::updateReferenceFrame()
+  {
+    invalidateTransform();
+    context_->queueRender();
+  }
+
+  void PolarGridDisplay::reportUpdateTime(std::chrono::steady_clock::time_point start)
+  {
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration < double, std::micro > (now - start).count();
+    // Exponential moving average, reported at most once per second since
+    // every status change goes through the property tree.
+    update_time_ = update_time_ > 0.0 ? 0.95 * update_time_ + 0.05 * elapsed : elapsed;
+    if (now - update_time_reported_ >= std::chrono::seconds(1)) {
+      update_time_reported_ = now;
+      reportMetrics();
     }
   }
 
+  void PolarGridDisplay::reportMetrics()
+  {
+    const PolarGridStats & stats = polar_grid_->getStats();
+    setStatus(
+      rviz_common::properties::StatusProperty::Ok, "Update Time",
+      QString("%1 us").arg(update_time_, 0, 'f', 1));
+    setStatus(
+      rviz_common::properties::StatusProperty::Ok, "Rebuilds",
+      QString("%1 rebuilds, last %2 us, %3 bytes uploaded")
+      .arg(stats.rebuilds)
+      .arg(stats.last_rebuild_time, 0, 'f', 1)
+      .arg(stats.uploaded_bytes));
+    if (!metrics_publisher_) {return;}
+
+    auto value = [](const std::string & key, auto number) {
+        diagnostic_msgs::msg::KeyValue key_value;
+        key_value.key = key;
+        key_value.value = std::to_string(number);
+        return key_value;
+      };
+    diagnostic_msgs::msg::DiagnosticStatus status;
+    status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+    status.name = "PolarGrid: " + getNameStd();
+    status.message = "OK";
+    status.values = {
+      value("update_time_us", update_time_),
+      value("rebuilds", stats.rebuilds),
+      value("rebuild_time_us", stats.rebuild_time),
+      value("last_rebuild_time_us", stats.last_rebuild_time),
+      value("uploaded_bytes", stats.uploaded_bytes),
+      value("vertices", polar_grid_->getVertexCount()),
+      value("vertex_bytes", polar_grid_->getVertexBufferSize()),
+      value("indices", polar_grid_->getIndexCount()),
+      value("index_bytes", polar_grid_->getIndexBufferSize()),
+      value("batches", polar_grid_->getBatchCount()),
+    };
+    diagnostic_msgs::msg::DiagnosticArray array;
+    array.header.stamp = context_->getClock()->now();
+    array.status.push_back(std::move(status));
+    metrics_publisher_->publish(array);
+  }
+
+  void PolarGridDisplay::updateMetricsTopic()
+  {
+    metrics_publisher_.reset();
+    std::string topic = metrics_topic_property_->getTopicStd();
+    if (topic.empty()) {
+      deleteStatus("Metrics Topic");
+      return;
+    }
+    try {
+      metrics_publisher_ = context_->getRosNodeAbstraction().lock()->get_raw_node()
+        ->create_publisher < diagnostic_msgs::msg::DiagnosticArray > (topic, rclcpp::QoS(1));
+    } catch (const std::exception & e) {
+      setStatus(
+        rviz_common::properties::StatusProperty::Error, "Metrics Topic",
+        QString("Error advertising: ") + e.what());
+      return;
+    }
+    deleteStatus("Metrics Topic");
+  }
+
+  double PolarGridDisplay::getUpdateTime() const {return update_time_;}
+
+  void PolarGridDisplay::update(float /* dt */, float /* ros_dt */)
+  {
+    auto start = std::chrono::steady_clock::now();
+    updateTransform();
+    applyLiveParams();
+    uploadHeatmap();
+    moveSweep();
+
+    rviz_common::ViewController * view = context_->getViewManager()->getCurrent();
+    if (view) {
+      polar_grid_->setCamera(view->getCamera());
+    }
+
+    // Setters only mark the grid dirty, so the property changes of one frame
+    // collapse into a single rebuild here.
+    if (polar_grid_->update()) {
+      setStatus(
+        rviz_common::properties::StatusProperty::Ok, "Geometry",
+        QString("%1 vertices (%2 bytes), %3 indices (%4 bytes), %5 batches")
+        .arg(polar_grid_->getVertexCount())
+        .arg(polar_grid_->getVertexBufferSize())
+        .arg(polar_grid_->getIndexCount())
+        .arg(polar_grid_->getIndexBufferSize())
+        .arg(polar_grid_->getBatchCount()));
+    }
+    reportUpdateTime(start);
+  }
+
   void PolarGridDisplay::updateColor()
   {
     Ogre::ColourValue color = color_property_->getOgreColor();
@@ -160,6 +861,12 @@ namespace polar_grid_rviz_plugins {
     context_->queueRender();
   }
 
+  void PolarGridDisplay::updateMajorEvery()
+  {
+    polar_grid_->setMajorEvery(major_every_property_->getInt());
+    context_->queueRender();
+  }
+
   void PolarGridDisplay::updatePlane()
   {
     Ogre::Quaternion q;
@@ -223,6 +930,67 @@ namespace polar_grid_rviz_plugins {
     context_->queueRender();
   }
 
+  void PolarGridDisplay::updatePixelTolerance()
+  {
+    polar_grid_->setPixelTolerance(pixel_tolerance_property_->getFloat());
+    context_->queueRender();
+  }
+
+  void PolarGridDisplay::updateLodPixelSpacing()
+  {
+    polar_grid_->setLodPixelSpacing(lod_pixel_spacing_property_->getFloat());
+    context_->queueRender();
+  }
+
+  void PolarGridDisplay::updateLabels()
+  {
+    if (polar_grid_->setLabels(labels_property_->getBool())) {
+      deleteStatus("Labels");
+    } else {
+      setStatus(
+        rviz_common::properties::StatusProperty::Warn, "Labels",
+        "The label font or material is not available.");
+    }
+    context_->queueRender();
+  }
+
+  void PolarGridDisplay::updateLabelColor()
+  {
+    Ogre::ColourValue color = label_color_property_->getOgreColor();
+    polar_grid_->setLabelColor(color.r, color.g, color.b, 1.f);
+    context_->queueRender();
+  }
+
+  void PolarGridDisplay::updateLabelSize()
+  {
+    polar_grid_->setLabelSize(label_size_property_->getFloat());
+    context_->queueRender();
+  }
+
+  void PolarGridDisplay::updateRenderMode()
+  {
+    auto render_mode =
+      static_cast < PolarGrid::RenderMode > (render_mode_property_->getOptionInt());
+    polar_grid_->setRenderMode(render_mode);
+    if (polar_grid_->getRenderMode() != render_mode) {
+      setStatus(
+        rviz_common::properties::StatusProperty::Warn, "Render Mode",
+        "Shader mode is not supported, using lines.");
+    } else {
+      deleteStatus("Render Mode");
+    }
+    pixel_tolerance_property_->setHidden(render_mode != PolarGrid::RenderMode::kLines);
+    lod_pixel_spacing_property_->setHidden(render_mode != PolarGrid::RenderMode::kLines);
+    share_geometry_property_->setHidden(render_mode != PolarGrid::RenderMode::kLines);
+    context_->queueRender();
+  }
+
+  void PolarGridDisplay::updateShareGeometry()
+  {
+    polar_grid_->setShareGeometry(share_geometry_property_->getBool());
+    context_->queueRender();
+  }
+
 }  // namespace polar_grid_rviz_plugins
 
 #include <pluginlib/class_list_macros.hpp>
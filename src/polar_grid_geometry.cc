@@ -0,0 +1,338 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <algorithm>
+#include <cmath>
+
+#include <polar_grid_rviz_plugins/polar_grid_geometry.hpp>
+
+namespace polar_grid_rviz_plugins {
+
+  namespace {
+
+  constexpr float kFixedSegments = 360.f;
+
+  bool isClosed(float start_angle, float end_angle) {return start_angle + 360.f == end_angle;}
+
+  void bandRings(const PolarGridParams & params, int band, int & first, int & last)
+  {
+    first = band * bandCircles(params);
+    last = std::min(first + bandCircles(params), params.circles_count);
+  }
+
+  // Radial extent of a band, the bands tile the grid from the minimum radius.
+  void bandRadii(const PolarGridParams & params, int band, float & inner, float & outer)
+  {
+    int first = 0, last = 0;
+    bandRings(params, band, first, last);
+    inner = first == 0 ? params.min_radius : ringRadius(params, first - 1);
+    outer = last > first ? ringRadius(params, last - 1) : inner;
+  }
+
+  void sliceRange(
+    const PolarGridParams & params, int band, int slice, float & start_angle, float & span)
+  {
+    float end_angle = 0.f;
+    angularRange(params, start_angle, end_angle);
+    span = (end_angle - start_angle) / bandSlices(params, band);
+    start_angle += slice * span;
+  }
+
+  // Spokes first to last - 1 fall in the slice, a spoke belongs to the slice
+  // its angle starts.
+  void sliceSpokes(const PolarGridParams & params, int band, int slice, int & first, int & last)
+  {
+    float start_angle = 0.f, end_angle = 0.f;
+    angularRange(params, start_angle, end_angle);
+    first = last = 0;
+    if (!params.sectors || start_angle == end_angle) {
+      return;
+    }
+    int slices = bandSlices(params, band);
+    int sectors = params.sector_count;
+    first = (slice * sectors + slices - 1) / slices;
+    if (slice + 1 < slices) {
+      last = ((slice + 1) * sectors + slices - 1) / slices;
+    } else {
+      last = sectors + (isClosed(start_angle, end_angle) ? 0 : 1);
+    }
+  }
+
+  void computeBounds(PolarGridGeometry & geometry)
+  {
+    float * bounds = geometry.bounds;
+    if (geometry.positions.empty()) {
+      std::fill(bounds, bounds + 6, 0.f);
+      return;
+    }
+    std::copy(geometry.positions.begin(), geometry.positions.begin() + 3, bounds);
+    std::copy(geometry.positions.begin(), geometry.positions.begin() + 3, bounds + 3);
+    for (size_t i = 3; i < geometry.positions.size(); i += 3) {
+      for (size_t j = 0; j < 3; ++j) {
+        bounds[j] = std::min(bounds[j], geometry.positions[i + j]);
+        bounds[j + 3] = std::max(bounds[j + 3], geometry.positions[i + j]);
+      }
+    }
+  }
+
+  template<typename T>
+  void appendKey(std::string & key, const T & value)
+  {
+    key.append(reinterpret_cast < const char * > (&value), sizeof(value));
+  }
+
+  }  // namespace
+
+  void angularRange(const PolarGridParams & params, float & start_angle, float & end_angle)
+  {
+    if (params.sectors) {
+      if (params.invert) {
+        start_angle = params.max_angle;
+        end_angle = params.min_angle + 360.f;
+      } else {
+        start_angle = params.min_angle;
+        end_angle = params.max_angle;
+      }
+    } else {
+      start_angle = 0.f;
+      end_angle = 360.f;
+    }
+  }
+
+  float ringRadius(const PolarGridParams & params, int ring)
+  {
+    return params.min_radius + (ring + (params.min_radius < 1e-6 ? 1 : 0)) * params.radius_step;
+  }
+
+  int ringSegments(const PolarGridParams & params, int ring, float span)
+  {
+    // An inverted full range leaves nothing to draw.
+    if (!(span > 1e-3f)) {
+      return 0;
+    }
+    float segments = kFixedSegments;
+    if (ring < static_cast < int > (params.ring_levels.size())) {
+      segments = static_cast < float > (1 << params.ring_levels[ring]);
+    }
+    return std::max(1, static_cast < int > (std::ceil(segments * span / 360.f - 1e-3f)));
+  }
+
+  int bandCircles(const PolarGridParams & params)
+  {
+    return std::max(kBandCircles, (params.circles_count + kMaxBands - 1) / kMaxBands);
+  }
+
+  int bandCount(const PolarGridParams & params)
+  {
+    return (params.circles_count + bandCircles(params) - 1) / bandCircles(params);
+  }
+
+  int bandSlices(const PolarGridParams & params, int band)
+  {
+    float start_angle = 0.f, end_angle = 0.f, inner = 0.f, outer = 0.f;
+    angularRange(params, start_angle, end_angle);
+    bandRadii(params, band, inner, outer);
+    float width = std::max({outer - inner, params.radius_step, kMinSliceExtent});
+    float arc = outer * static_cast < float > (M_PI) * (end_angle - start_angle) / 180.f;
+    if (!(width > 1e-6f) || !(arc > width)) {
+      return 1;
+    }
+    return std::min(kMaxBandSlices, static_cast < int > (std::ceil(arc / width)));
+  }
+
+  RingTier ringTier(const PolarGridParams & params, int ring)
+  {
+    if (params.major_every <= 1) {
+      return RingTier::kMajor;
+    }
+    // Count in radius steps so that major circles sit on round multiples.
+    int step = ring + (params.min_radius < 1e-6 ? 1 : 0);
+    return step % params.major_every == 0 ? RingTier::kMajor : RingTier::kMinor;
+  }
+
+  std::string chunkKey(
+    const PolarGridParams & params, int band, int slice, bool spokes, RingTier tier)
+  {
+    // Only the circles of the band matter, not how many the grid has, and
+    // the sector angles only through the arc they span.
+    float start_angle = 0.f, end_angle = 0.f;
+    angularRange(params, start_angle, end_angle);
+    int first = 0, last = 0;
+    bandRings(params, band, first, last);
+    std::string key;
+    key.reserve(64);
+    appendKey(key, spokes);
+    appendKey(key, band);
+    appendKey(key, slice);
+    appendKey(key, last - first);
+    appendKey(key, params.min_radius);
+    appendKey(key, params.radius_step);
+    appendKey(key, start_angle);
+    appendKey(key, end_angle);
+    if (spokes) {
+      appendKey(key, params.sectors);
+      appendKey(key, params.sector_count);
+      return key;
+    }
+    appendKey(key, tier);
+    appendKey(key, params.major_every);
+    for (int i = first; i < last; ++i) {
+      appendKey(
+        key, i < static_cast < int > (params.ring_levels.size()) ? params.ring_levels[i] : -1);
+    }
+    return key;
+  }
+
+  void countBand(
+    const PolarGridParams & params, int band, int slice, RingTier tier, size_t & vertices,
+    size_t & indices)
+  {
+    float start_angle = 0.f, span = 0.f;
+    sliceRange(params, band, slice, start_angle, span);
+    bool closed = isClosed(0.f, span);
+    int first = 0, last = 0;
+    bandRings(params, band, first, last);
+    vertices = indices = 0;
+    for (int i = first; i < last; ++i) {
+      if (ringTier(params, i) != tier) {continue;}
+      size_t segments = ringSegments(params, i, span);
+      if (segments == 0) {continue;}
+      vertices += closed ? segments : segments + 1;
+      indices += 2 * segments;
+    }
+  }
+
+  void countSpokes(
+    const PolarGridParams & params, int band, int slice, size_t & vertices, size_t & indices)
+  {
+    int first = 0, last = 0;
+    sliceSpokes(params, band, slice, first, last);
+    vertices = indices = 2 * static_cast < size_t > (last - first);
+  }
+
+  void writeBand(
+    const PolarGridParams & params, int band, int slice, RingTier tier, float * positions,
+    uint32_t * indices, std::vector < std::shared_ptr < const UnitCircle >> * tables)
+  {
+    float start_angle = 0.f, span = 0.f;
+    sliceRange(params, band, slice, start_angle, span);
+
+    // Circles are drawn as shared vertices joined by indexed segments, a
+    // full circle reuses its first vertex instead of repeating it.
+    bool closed = isClosed(0.f, span);
+
+    std::shared_ptr < const UnitCircle > table;
+    uint32_t vertex = 0;
+    int first = 0, last = 0;
+    bandRings(params, band, first, last);
+    for (int i = first; i < last; ++i) {
+      if (ringTier(params, i) != tier) {continue;}
+      float radius = ringRadius(params, i);
+      int segments = ringSegments(params, i, span);
+      if (segments == 0) {continue;}
+      if (!table || table->cos.size() != static_cast < size_t > (segments + 1)) {
+        table = getUnitCircle(start_angle, span, segments);
+        if (tables) {
+          tables->push_back(table);
+        }
+      }
+      int points = closed ? segments : segments + 1;
+      if (closed) {
+        // The table repeats the first point at its end, which must not spill
+        // into the next circle.
+        scaleUnitCircle(*table, radius, positions, points);
+      } else {
+        scaleUnitCircle(*table, radius, positions);
+      }
+      positions += 3 * points;
+      for (int j = 0; j < segments; ++j) {
+        *indices++ = vertex + j;
+        *indices++ = vertex + (j + 1) % points;
+      }
+      vertex += points;
+    }
+  }
+
+  void writeSpokes(
+    const PolarGridParams & params, int band, int slice, float * positions, uint32_t * indices)
+  {
+    int first = 0, last = 0;
+    sliceSpokes(params, band, slice, first, last);
+    float start_angle = 0.f, end_angle = 0.f, inner = 0.f, outer = 0.f;
+    angularRange(params, start_angle, end_angle);
+    bandRadii(params, band, inner, outer);
+    float angle_step = (end_angle - start_angle) / params.sector_count;
+    uint32_t vertex = 0;
+    for (int i = first; i < last; ++i) {
+      double angle_rad = M_PI * (start_angle + i * angle_step) / 180.0;
+      float c = static_cast < float > (std::cos(angle_rad));
+      float s = static_cast < float > (std::sin(angle_rad));
+      *positions++ = inner * c;
+      *positions++ = inner * s;
+      *positions++ = 0.f;
+      *positions++ = outer * c;
+      *positions++ = outer * s;
+      *positions++ = 0.f;
+      *indices++ = vertex;
+      *indices++ = vertex + 1;
+      vertex += 2;
+    }
+  }
+
+  void buildBand(
+    const PolarGridParams & params, int band, int slice, RingTier tier,
+    PolarGridGeometry & geometry)
+  {
+    size_t vertices = 0, indices = 0;
+    countBand(params, band, slice, tier, vertices, indices);
+    geometry.spokes = false;
+    geometry.band = band;
+    geometry.slice = slice;
+    geometry.tier = tier;
+    geometry.positions.resize(3 * vertices);
+    geometry.indices.resize(indices);
+    // Keep this build's tables cached until the next one.
+    std::vector < std::shared_ptr < const UnitCircle >> tables;
+    writeBand(
+      params, band, slice, tier, geometry.positions.data(), geometry.indices.data(), &tables);
+    geometry.tables.swap(tables);
+    computeBounds(geometry);
+  }
+
+  void buildSpokes(
+    const PolarGridParams & params, int band, int slice, PolarGridGeometry & geometry)
+  {
+    size_t vertices = 0, indices = 0;
+    countSpokes(params, band, slice, vertices, indices);
+    geometry.spokes = true;
+    geometry.band = band;
+    geometry.slice = slice;
+    geometry.tier = RingTier::kMajor;
+    geometry.positions.resize(3 * vertices);
+    geometry.indices.resize(indices);
+    geometry.tables.clear();
+    writeSpokes(params, band, slice, geometry.positions.data(), geometry.indices.data());
+    computeBounds(geometry);
+  }
+
+}  // namespace polar_grid_rviz_plugins
@@ -0,0 +1,384 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+#include <OgreFontManager.h>
+#include <OgreMaterialManager.h>
+#include <OgrePass.h>
+#include <OgreTechnique.h>
+#include <OgreTextureUnitState.h>
+#include <OgreViewport.h>
+
+#include <polar_grid_rviz_plugins/polar_grid_labels.hpp>
+
+namespace polar_grid_rviz_plugins {
+
+  namespace {
+
+  constexpr const char * kFontName = "Liberation Sans";
+  constexpr Ogre::Font::CodePoint kDegreeSign = 0xB0;
+  // Labels whose characters are smaller than this on screen are not readable.
+  constexpr float kMinCharPixels = 6.f;
+  // Side of the screen cells accepted labels are bucketed in.
+  constexpr float kCellPixels = 64.f;
+  // Horizontal gap kept between labels in character heights.
+  constexpr float kLabelGap = 0.25f;
+
+  bool sameLayout(const PolarGridParams & a, const PolarGridParams & b)
+  {
+    return a.min_radius == b.min_radius && a.radius_step == b.radius_step &&
+           a.circles_count == b.circles_count && a.sectors == b.sectors &&
+           a.min_angle == b.min_angle && a.max_angle == b.max_angle &&
+           a.sector_count == b.sector_count && a.invert == b.invert &&
+           a.major_every == b.major_every;
+  }
+
+  std::string formatNumber(double value)
+  {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%g", std::round(value * 1000.0) / 1000.0);
+    return text;
+  }
+
+  }  // namespace
+
+  PolarGridLabels::PolarGridLabels(
+    Ogre::SceneManager * scene_manager, Ogre::SceneNode * scene_node, const std::string & name)
+  {
+    scene_manager_ = scene_manager;
+    scene_node_ = scene_node;
+    vertex_capacity_ = index_capacity_ = 0;
+    degree_sign_ = false;
+    minor_visible_ = true;
+    char_height_ = 0.3f;
+    visible_ = true;
+    dirty_ = true;
+
+    font_ = Ogre::FontManager::getSingleton().getByName(
+      kFontName, Ogre::ResourceGroupManager::AUTODETECT_RESOURCE_GROUP_NAME);
+    Ogre::MaterialPtr base = Ogre::MaterialManager::getSingleton().getByName(
+      "PolarGrid/Labels", "rviz_rendering");
+    if (!font_ || !base) {
+      return;
+    }
+    font_->load();
+    base->load();
+    if (!base->getBestTechnique()) {
+      return;
+    }
+
+    // Sample the atlas of the shared font rather than rasterizing our own.
+    material_ = base->clone(name + "Material");
+    material_->getTechnique(0)->getPass(0)->getTextureUnitState(0)->setTextureName(
+      font_->getMaterial()->getTechnique(0)->getPass(0)->getTextureUnitState(0)->getTextureName());
+    for (const Ogre::Font::CodePointRange & range : font_->getCodePointRangeList()) {
+      degree_sign_ |= range.first <= kDegreeSign && kDegreeSign <= range.second;
+    }
+
+    mesh_ = std::shared_ptr < Ogre::ManualObject > (
+      scene_manager_->createManualObject(name), [scene_manager](Ogre::ManualObject * mesh) {
+        scene_manager->destroyManualObject(mesh);
+      });
+    mesh_->setDynamic(true);
+    scene_node_->attachObject(mesh_.get());
+  }
+
+  PolarGridLabels::~PolarGridLabels()
+  {
+    mesh_.reset();
+    if (material_) {
+      Ogre::MaterialManager::getSingleton().remove(material_->getHandle());
+    }
+  }
+
+  bool PolarGridLabels::isSupported() const {return static_cast < bool > (mesh_);}
+
+  void PolarGridLabels::setParams(const PolarGridParams & params)
+  {
+    if (sameLayout(params_, params)) {return;}
+    params_ = params;
+    params_.ring_levels.clear();
+    layout();
+  }
+
+  void PolarGridLabels::setMinorVisible(bool minor_visible) {minor_visible_ = minor_visible;}
+
+  void PolarGridLabels::setColor(const Ogre::ColourValue & color)
+  {
+    if (!isSupported()) {return;}
+    material_->getTechnique(0)->getPass(0)->getFragmentProgramParameters()
+    ->setNamedConstant("color", color);
+  }
+
+  void PolarGridLabels::setCharHeight(float char_height)
+  {
+    if (char_height_ == char_height) {return;}
+    char_height_ = char_height;
+    if (!isSupported()) {return;}
+    material_->getTechnique(0)->getPass(0)->getVertexProgramParameters()
+    ->setNamedConstant("size", char_height_);
+    // Bearing labels keep a character height away from the last circle.
+    layout();
+  }
+
+  void PolarGridLabels::setVisible(bool visible)
+  {
+    visible_ = visible;
+    if (mesh_) {
+      mesh_->setVisible(visible_);
+    }
+  }
+
+  size_t PolarGridLabels::getShownCount() const
+  {
+    return std::count(shown_.begin(), shown_.end(), true);
+  }
+
+  void PolarGridLabels::layout()
+  {
+    glyphs_.clear();
+    labels_.clear();
+    dirty_ = true;
+    if (!isSupported() || params_.circles_count <= 0) {
+      return;
+    }
+
+    float start_angle = 0.f, end_angle = 0.f;
+    angularRange(params_, start_angle, end_angle);
+    double start_rad = M_PI * start_angle / 180.0;
+    Ogre::Vector3 along(
+      static_cast < float > (std::cos(start_rad)),
+      static_cast < float > (std::sin(start_rad)), 0.f);
+
+    // Labels are added in priority order: major ranges, bearings, then minor
+    // ranges.
+    for (int i = 0; i < params_.circles_count; ++i) {
+      if (ringTier(params_, i) != RingTier::kMajor) {continue;}
+      float radius = ringRadius(params_, i);
+      addLabel(formatNumber(radius), along * radius, false, 0.f, 0.f);
+    }
+
+    if (params_.sectors && start_angle != end_angle) {
+      bool closed = start_angle + 360.f == end_angle;
+      float radius = ringRadius(params_, params_.circles_count - 1) + char_height_;
+      float angle_step = (end_angle - start_angle) / params_.sector_count;
+      for (int i = 0; i < params_.sector_count + (closed ? 0 : 1); ++i) {
+        float angle = start_angle + i * angle_step;
+        double angle_rad = M_PI * angle / 180.0;
+        Ogre::Vector3 anchor(
+          radius * static_cast < float > (std::cos(angle_rad)),
+          radius * static_cast < float > (std::sin(angle_rad)), 0.f);
+        std::string text = formatNumber(std::remainder(angle, 360.f));
+        if (degree_sign_) {
+          text += static_cast < char > (kDegreeSign);
+        }
+        addLabel(text, anchor, false, 0.5f, 0.5f);
+      }
+    }
+
+    for (int i = 0; i < params_.circles_count; ++i) {
+      if (ringTier(params_, i) != RingTier::kMinor) {continue;}
+      float radius = ringRadius(params_, i);
+      addLabel(formatNumber(radius), along * radius, true, 0.f, 0.f);
+    }
+  }
+
+  void PolarGridLabels::addLabel(
+    const std::string & text, const Ogre::Vector3 & anchor, bool minor, float align_x,
+    float align_y)
+  {
+    Label label;
+    label.anchor = anchor;
+    label.minor = minor;
+    label.first_glyph = glyphs_.size();
+    label.glyph_count = text.size();
+
+    float width = 0.f;
+    for (char c : text) {
+      Ogre::Font::CodePoint code_point = static_cast < unsigned char > (c);
+      float advance = font_->getGlyphAspectRatio(code_point);
+      glyphs_.push_back({width, 0.f, width + advance, 1.f, font_->getGlyphTexCoords(code_point)});
+      width += advance;
+    }
+
+    // Move the glyphs so that the anchor sits at align_x, align_y of the text.
+    float dx = -align_x * width, dy = -align_y;
+    for (size_t i = label.first_glyph; i < glyphs_.size(); ++i) {
+      glyphs_[i].left += dx;
+      glyphs_[i].right += dx;
+      glyphs_[i].bottom += dy;
+      glyphs_[i].top += dy;
+    }
+    label.left = dx;
+    label.right = dx + width;
+    label.bottom = dy;
+    label.top = dy + 1.f;
+    labels_.push_back(label);
+  }
+
+  void PolarGridLabels::update(const Ogre::Camera * camera)
+  {
+    if (!isSupported() || !visible_ || !camera || !camera->getViewport()) {return;}
+    float width = static_cast < float > (camera->getViewport()->getActualWidth());
+    float height = static_cast < float > (camera->getViewport()->getActualHeight());
+    if (width <= 0.f || height <= 0.f) {return;}
+
+    Ogre::Matrix4 world_view = camera->getViewMatrix() * scene_node_->_getFullTransform();
+    const Ogre::Matrix4 & projection = camera->getProjectionMatrix();
+    // Character height in pixels at a clip w of 1, this covers both
+    // perspective and orthographic projections.
+    float char_pixels = char_height_ * projection[1][1] * 0.5f * height;
+
+    int columns = static_cast < int > (std::ceil(width / kCellPixels));
+    int rows = static_cast < int > (std::ceil(height / kCellPixels));
+    cells_.resize(columns * rows);
+    for (std::vector < uint32_t > & cell : cells_) {
+      cell.clear();
+    }
+    rects_.clear();
+
+    // Greedily accept labels in priority order, dropping the ones that are
+    // too small, off screen or overlap an accepted label.
+    std::vector < bool > shown(labels_.size(), false);
+    for (size_t i = 0; i < labels_.size(); ++i) {
+      const Label & label = labels_[i];
+      if (label.minor && !minor_visible_) {continue;}
+      const Ogre::Vector3 & anchor = label.anchor;
+      Ogre::Vector4 clip =
+        projection * (world_view * Ogre::Vector4(anchor.x, anchor.y, anchor.z, 1.f));
+      if (clip.w <= 1e-6f) {continue;}
+      float size = char_pixels / clip.w;
+      if (size < kMinCharPixels) {continue;}
+
+      float x = (0.5f + 0.5f * clip.x / clip.w) * width;
+      float y = (0.5f - 0.5f * clip.y / clip.w) * height;
+      Ogre::Vector4 rect(
+        x + (label.left - kLabelGap) * size, y - label.top * size,
+        x + (label.right + kLabelGap) * size, y - label.bottom * size);
+      if (rect.z < 0.f || rect.x > width || rect.w < 0.f || rect.y > height) {continue;}
+
+      int first_column = std::clamp(static_cast < int > (rect.x / kCellPixels), 0, columns - 1);
+      int last_column = std::clamp(static_cast < int > (rect.z / kCellPixels), 0, columns - 1);
+      int first_row = std::clamp(static_cast < int > (rect.y / kCellPixels), 0, rows - 1);
+      int last_row = std::clamp(static_cast < int > (rect.w / kCellPixels), 0, rows - 1);
+      bool overlaps = false;
+      for (int r = first_row; r <= last_row && !overlaps; ++r) {
+        for (int c = first_column; c <= last_column && !overlaps; ++c) {
+          for (uint32_t j : cells_[r * columns + c]) {
+            const Ogre::Vector4 & other = rects_[j];
+            if (rect.x < other.z && other.x < rect.z && rect.y < other.w && other.y < rect.w) {
+              overlaps = true;
+              break;
+            }
+          }
+        }
+      }
+      if (overlaps) {continue;}
+
+      uint32_t index = static_cast < uint32_t > (rects_.size());
+      rects_.push_back(rect);
+      for (int r = first_row; r <= last_row; ++r) {
+        for (int c = first_column; c <= last_column; ++c) {
+          cells_[r * columns + c].push_back(index);
+        }
+      }
+      shown[i] = true;
+    }
+
+    if (dirty_ || shown != shown_) {
+      shown_.swap(shown);
+      rebuild();
+    }
+  }
+
+  void PolarGridLabels::rebuild()
+  {
+    dirty_ = false;
+    size_t glyphs = 0;
+    for (size_t i = 0; i < labels_.size(); ++i) {
+      if (shown_[i]) {
+        glyphs += labels_[i].glyph_count;
+      }
+    }
+
+    // Same high-water buffers as the line chunks of the grid.
+    size_t vertices = 4 * glyphs, indices = 6 * glyphs;
+    if (vertices > vertex_capacity_ || indices > index_capacity_) {
+      vertex_capacity_ = std::max(vertex_capacity_, vertices + vertices / 2);
+      index_capacity_ = std::max(index_capacity_, indices + indices / 2);
+    }
+    mesh_->estimateVertexCount(vertex_capacity_);
+    mesh_->estimateIndexCount(index_capacity_);
+    if (mesh_->getNumSections() == 0) {
+      mesh_->begin(material_->getName(), Ogre::RenderOperation::OT_TRIANGLE_LIST, "rviz_rendering");
+    } else {
+      mesh_->beginUpdate(0);
+    }
+
+    // Every corner carries the anchor of its label, the atlas coordinates and
+    // its offset from the anchor, which the vertex program applies in view
+    // space.
+    Ogre::AxisAlignedBox box;
+    float reach = 0.f;
+    uint32_t vertex = 0;
+    for (size_t i = 0; i < labels_.size(); ++i) {
+      if (!shown_[i]) {continue;}
+      const Label & label = labels_[i];
+      box.merge(label.anchor);
+      reach = std::max(
+        {reach, std::abs(label.left), std::abs(label.right), std::abs(label.bottom),
+          std::abs(label.top)});
+      for (size_t j = label.first_glyph; j < label.first_glyph + label.glyph_count; ++j) {
+        const Glyph & glyph = glyphs_[j];
+        mesh_->position(label.anchor);
+        mesh_->textureCoord(glyph.uv.left, glyph.uv.bottom);
+        mesh_->textureCoord(glyph.left, glyph.bottom);
+        mesh_->position(label.anchor);
+        mesh_->textureCoord(glyph.uv.right, glyph.uv.bottom);
+        mesh_->textureCoord(glyph.right, glyph.bottom);
+        mesh_->position(label.anchor);
+        mesh_->textureCoord(glyph.uv.right, glyph.uv.top);
+        mesh_->textureCoord(glyph.right, glyph.top);
+        mesh_->position(label.anchor);
+        mesh_->textureCoord(glyph.uv.left, glyph.uv.top);
+        mesh_->textureCoord(glyph.left, glyph.top);
+        mesh_->quad(vertex, vertex + 1, vertex + 2, vertex + 3);
+        vertex += 4;
+      }
+    }
+    mesh_->end();
+
+    // The quads are offset in the vertex program, so pad the anchors by the
+    // largest offset in any direction.
+    if (!box.isNull()) {
+      Ogre::Vector3 pad = Ogre::Vector3::UNIT_SCALE * (reach * char_height_);
+      mesh_->setBoundingBox(Ogre::AxisAlignedBox(box.getMinimum() - pad, box.getMaximum() + pad));
+    }
+    scene_node_->needUpdate();
+  }
+
+}  // namespace polar_grid_rviz_plugins
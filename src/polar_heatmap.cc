@@ -0,0 +1,167 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <algorithm>
+
+#include <OgreHardwarePixelBuffer.h>
+#include <OgrePass.h>
+#include <OgreTextureManager.h>
+#include <OgreTextureUnitState.h>
+
+#include <polar_grid_rviz_plugins/polar_heatmap.hpp>
+#include <sensor_msgs/image_encodings.hpp>
+
+namespace polar_grid_rviz_plugins {
+
+  PolarHeatmap::PolarHeatmap(Ogre::SceneManager * scene_manager, Ogre::SceneNode * parent_node)
+  {
+    static int count = 0;
+    name_ = "PolarHeatmap" + std::to_string(count++);
+    visible_ = true;
+
+    // Nothing to show until the first array arrives.
+    quad_ = std::make_unique < ShaderQuad > (
+      scene_manager, parent_node, name_, "PolarGrid/Heatmap");
+  }
+
+  PolarHeatmap::~PolarHeatmap()
+  {
+    // The material samples the texture, so it goes first.
+    quad_.reset();
+    if (texture_) {
+      Ogre::TextureManager::getSingleton().remove(texture_->getHandle());
+    }
+  }
+
+  bool PolarHeatmap::isSupported() const {return quad_->isSupported();}
+
+  bool PolarHeatmap::upload(const sensor_msgs::msg::Image & image, std::string & error)
+  {
+    if (!isSupported()) {
+      error = "The heatmap material is not available.";
+      return false;
+    }
+
+    namespace encodings = sensor_msgs::image_encodings;
+    Ogre::PixelFormat format;
+    float value_scale = 1.f;
+    if (image.encoding == encodings::MONO8 || image.encoding == encodings::TYPE_8UC1) {
+      format = Ogre::PF_L8;
+      value_scale = 255.f;
+    } else if (image.encoding == encodings::MONO16 || image.encoding == encodings::TYPE_16UC1) {
+      format = Ogre::PF_L16;
+      value_scale = 65535.f;
+    } else if (image.encoding == encodings::TYPE_32FC1) {
+      format = Ogre::PF_FLOAT32_R;
+    } else {
+      error = "Unsupported encoding " + image.encoding + ", use mono8, mono16 or 32FC1.";
+      return false;
+    }
+    size_t pixel_size = Ogre::PixelUtil::getNumElemBytes(format);
+    if (image.width == 0 || image.height == 0 || image.step % pixel_size != 0 ||
+      image.step < image.width * pixel_size || image.data.size() < image.step * image.height)
+    {
+      error = "Malformed image.";
+      return false;
+    }
+
+    // The texture only changes when the shape or the format of the arrays
+    // does, every other message is a plain upload.
+    if (!texture_ || texture_->getWidth() != image.width ||
+      texture_->getHeight() != image.height || texture_->getFormat() != format)
+    {
+      if (texture_) {
+        Ogre::TextureManager::getSingleton().remove(texture_->getHandle());
+      }
+      texture_ = Ogre::TextureManager::getSingleton().createManual(
+        name_ + "Texture", "rviz_rendering", Ogre::TEX_TYPE_2D, image.width, image.height, 0,
+        format, Ogre::TU_DYNAMIC_WRITE_ONLY_DISCARDABLE);
+      Ogre::Pass * pass = quad_->getPass();
+      pass->getTextureUnitState(0)->setTexture(texture_);
+      pass->getFragmentProgramParameters()->setNamedConstant("value_scale", value_scale);
+    }
+
+    // Blit straight from the message, padded rows included.
+    Ogre::PixelBox box(
+      image.width, image.height, 1, format, const_cast < uint8_t * > (image.data.data()));
+    box.rowPitch = image.step / pixel_size;
+    box.slicePitch = box.rowPitch * image.height;
+    texture_->getBuffer()->blitFromMemory(box);
+
+    quad_->setVisible(visible_);
+    return true;
+  }
+
+  void PolarHeatmap::setParams(const PolarGridParams & params)
+  {
+    if (!isSupported()) {return;}
+    float start_angle = 0.f, end_angle = 0.f;
+    angularRange(params, start_angle, end_angle);
+    float max_radius = params.circles_count > 0 ?
+      ringRadius(params, params.circles_count - 1) : params.min_radius;
+    float extent = std::max(max_radius, 0.01f);
+
+    quad_->setExtent(extent);
+    Ogre::GpuProgramParametersSharedPtr fragment =
+      quad_->getPass()->getFragmentProgramParameters();
+    fragment->setNamedConstant("min_radius", params.min_radius);
+    fragment->setNamedConstant("max_radius", max_radius);
+    fragment->setNamedConstant("start_angle", Ogre::Math::PI * start_angle / 180.f);
+    fragment->setNamedConstant("span", Ogre::Math::PI * (end_angle - start_angle) / 180.f);
+  }
+
+  void PolarHeatmap::setValueRange(float min_value, float max_value)
+  {
+    if (!isSupported()) {return;}
+    Ogre::GpuProgramParametersSharedPtr fragment =
+      quad_->getPass()->getFragmentProgramParameters();
+    fragment->setNamedConstant("min_value", min_value);
+    fragment->setNamedConstant("max_value", max_value);
+  }
+
+  void PolarHeatmap::setColorMap(ColorMap color_map)
+  {
+    if (!isSupported()) {return;}
+    quad_->getPass()->getFragmentProgramParameters()->setNamedConstant(
+      "color_map", static_cast < float > (color_map));
+  }
+
+  void PolarHeatmap::setAlpha(float alpha)
+  {
+    if (!isSupported()) {return;}
+    quad_->getPass()->getFragmentProgramParameters()->setNamedConstant(
+      "alpha", alpha);
+  }
+
+  std::string PolarHeatmap::getTextureName() const
+  {
+    return texture_ ? texture_->getName() : std::string();
+  }
+
+  void PolarHeatmap::setVisible(bool visible)
+  {
+    visible_ = visible;
+    quad_->setVisible(visible_ && texture_);
+  }
+
+}  // namespace polar_grid_rviz_plugins
@@ -0,0 +1,88 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <algorithm>
+
+#include <polar_grid_rviz_plugins/polar_sweep.hpp>
+
+namespace polar_grid_rviz_plugins {
+
+  PolarSweep::PolarSweep(Ogre::SceneManager * scene_manager, Ogre::SceneNode * parent_node)
+  {
+    static int count = 0;
+    name_ = "PolarSweep" + std::to_string(count++);
+    quad_ = std::make_unique < ShaderQuad > (scene_manager, parent_node, name_, "PolarGrid/Sweep");
+    if (quad_->isSupported()) {
+      fragment_ = quad_->getPass()->getFragmentProgramParameters();
+    }
+  }
+
+  bool PolarSweep::isSupported() const {return quad_->isSupported();}
+
+  void PolarSweep::setParams(const PolarGridParams & params)
+  {
+    if (!isSupported()) {return;}
+    if (has_params_ && params_.min_radius == params.min_radius &&
+      params_.radius_step == params.radius_step && params_.circles_count == params.circles_count &&
+      params_.sectors == params.sectors && params_.min_angle == params.min_angle &&
+      params_.max_angle == params.max_angle && params_.invert == params.invert)
+    {
+      return;
+    }
+    params_ = params;
+    has_params_ = true;
+    float start_angle = 0.f, end_angle = 0.f;
+    angularRange(params, start_angle, end_angle);
+    float max_radius = params.circles_count > 0 ?
+      ringRadius(params, params.circles_count - 1) : params.min_radius;
+    float extent = std::max(max_radius, 0.01f);
+
+    quad_->setExtent(extent);
+    fragment_->setNamedConstant("min_radius", params.min_radius);
+    fragment_->setNamedConstant("max_radius", max_radius);
+    fragment_->setNamedConstant("start_angle", Ogre::Math::PI * start_angle / 180.f);
+    fragment_->setNamedConstant("span", Ogre::Math::PI * (end_angle - start_angle) / 180.f);
+  }
+
+  void PolarSweep::setColor(const Ogre::ColourValue & color)
+  {
+    if (!isSupported()) {return;}
+    fragment_->setNamedConstant("color", color);
+  }
+
+  void PolarSweep::setTrail(float trail, bool counterclockwise)
+  {
+    if (!isSupported()) {return;}
+    fragment_->setNamedConstant("trail", Ogre::Math::PI * trail / 180.f);
+    fragment_->setNamedConstant("direction", counterclockwise ? 1.f : -1.f);
+  }
+
+  void PolarSweep::setAngle(float angle)
+  {
+    if (!isSupported()) {return;}
+    fragment_->setNamedConstant("angle", Ogre::Math::PI * angle / 180.f);
+  }
+
+  void PolarSweep::setVisible(bool visible) {quad_->setVisible(visible);}
+
+}  // namespace polar_grid_rviz_plugins
@@ -0,0 +1,93 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <OgreMaterialManager.h>
+#include <OgreTechnique.h>
+
+#include <polar_grid_rviz_plugins/shader_quad.hpp>
+
+namespace polar_grid_rviz_plugins {
+
+  ShaderQuad::ShaderQuad(
+    Ogre::SceneManager * scene_manager, Ogre::SceneNode * parent_node, const std::string & name,
+    const std::string & base)
+  {
+    Ogre::MaterialPtr material = Ogre::MaterialManager::getSingleton().getByName(
+      base, "rviz_rendering");
+    if (!material) {
+      return;
+    }
+    material->load();
+    if (!material->getBestTechnique()) {
+      return;
+    }
+    material_ = material->clone(name + "Material");
+    // Write the uniforms to the technique that is actually rendered.
+    material_->load();
+    pass_ = material_->getBestTechnique()->getPass(0);
+
+    quad_ = std::shared_ptr < Ogre::ManualObject > (
+      scene_manager->createManualObject(name), [scene_manager](Ogre::ManualObject * quad) {
+        scene_manager->destroyManualObject(quad);
+      });
+    quad_->begin(material_->getName(), Ogre::RenderOperation::OT_TRIANGLE_STRIP, "rviz_rendering");
+    quad_->position(-1.f, -1.f, 0.f);
+    quad_->position(1.f, -1.f, 0.f);
+    quad_->position(-1.f, 1.f, 0.f);
+    quad_->position(1.f, 1.f, 0.f);
+    quad_->end();
+    parent_node->attachObject(quad_.get());
+    quad_->setVisible(false);
+  }
+
+  ShaderQuad::~ShaderQuad()
+  {
+    quad_.reset();
+    if (material_) {
+      Ogre::MaterialManager::getSingleton().remove(material_->getHandle());
+    }
+  }
+
+  bool ShaderQuad::isSupported() const {return static_cast < bool > (quad_);}
+
+  const Ogre::MaterialPtr & ShaderQuad::getMaterial() const {return material_;}
+
+  Ogre::Pass * ShaderQuad::getPass() const {return pass_;}
+
+  Ogre::ManualObject * ShaderQuad::getObject() const {return quad_.get();}
+
+  void ShaderQuad::setExtent(float extent)
+  {
+    if (!isSupported()) {return;}
+    getPass()->getVertexProgramParameters()->setNamedConstant("extent", extent);
+    quad_->setBoundingBox(Ogre::AxisAlignedBox(-extent, -extent, 0.f, extent, extent, 0.f));
+  }
+
+  void ShaderQuad::setVisible(bool visible)
+  {
+    if (quad_) {
+      quad_->setVisible(visible);
+    }
+  }
+
+}  // namespace polar_grid_rviz_plugins
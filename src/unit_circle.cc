@@ -0,0 +1,119 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <polar_grid_rviz_plugins/unit_circle.hpp>
+
+namespace polar_grid_rviz_plugins {
+
+  std::shared_ptr < const UnitCircle > getUnitCircle(float start, float span, int segments)
+  {
+    using Key = std::tuple < float, float, int >;
+    static std::mutex mutex;
+    static std::map < Key, std::weak_ptr < const UnitCircle >> cache;
+
+    std::lock_guard < std::mutex > lock(mutex);
+    Key key(start, span, segments);
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+      if (auto circle = it->second.lock()) {
+        return circle;
+      }
+    }
+
+    // Drop the tables nobody uses anymore before adding a new one.
+    for (auto jt = cache.begin(); jt != cache.end(); ) {
+      jt = jt->second.expired() ? cache.erase(jt) : std::next(jt);
+    }
+
+    auto circle = std::make_shared < UnitCircle > ();
+    circle->cos.resize(segments + 1);
+    circle->sin.resize(segments + 1);
+    double start_rad = M_PI * start / 180.0;
+    double step_rad = M_PI * span / 180.0 / segments;
+    for (int i = 0; i <= segments; ++i) {
+      double angle = start_rad + i * step_rad;
+      circle->cos[i] = static_cast < float > (std::cos(angle));
+      circle->sin[i] = static_cast < float > (std::sin(angle));
+    }
+    cache[key] = circle;
+    return circle;
+  }
+
+  void scaleUnitCircle(const UnitCircle & circle, float radius, float * out, size_t count)
+  {
+    const float * c = circle.cos.data();
+    const float * s = circle.sin.data();
+    size_t size = std::min(count, circle.cos.size());
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128 r = _mm_set1_ps(radius);
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= size; i += 4) {
+      __m128 x = _mm_mul_ps(_mm_loadu_ps(c + i), r);
+      __m128 y = _mm_mul_ps(_mm_loadu_ps(s + i), r);
+      __m128 xy01 = _mm_unpacklo_ps(x, y);  // x0 y0 x1 y1
+      __m128 xy23 = _mm_unpackhi_ps(x, y);  // x2 y2 x3 y3
+      // x0 y0 0 x1 | y1 0 x2 y2 | 0 x3 y3 0
+      __m128 a = _mm_shuffle_ps(
+        xy01, _mm_shuffle_ps(zero, xy01, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0));
+      __m128 b = _mm_shuffle_ps(
+        _mm_shuffle_ps(xy01, zero, _MM_SHUFFLE(0, 0, 3, 3)), xy23, _MM_SHUFFLE(1, 0, 2, 0));
+      __m128 d = _mm_shuffle_ps(
+        _mm_shuffle_ps(zero, xy23, _MM_SHUFFLE(2, 2, 0, 0)),
+        _mm_shuffle_ps(xy23, zero, _MM_SHUFFLE(0, 0, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+      _mm_storeu_ps(out + 3 * i, a);
+      _mm_storeu_ps(out + 3 * i + 4, b);
+      _mm_storeu_ps(out + 3 * i + 8, d);
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t zero = vdupq_n_f32(0.f);
+    for (; i + 4 <= size; i += 4) {
+      float32x4x3_t xyz;
+      xyz.val[0] = vmulq_n_f32(vld1q_f32(c + i), radius);
+      xyz.val[1] = vmulq_n_f32(vld1q_f32(s + i), radius);
+      xyz.val[2] = zero;
+      vst3q_f32(out + 3 * i, xyz);
+    }
+#endif
+
+    for (; i < size; ++i) {
+      out[3 * i] = radius * c[i];
+      out[3 * i + 1] = radius * s[i];
+      out[3 * i + 2] = 0.f;
+    }
+  }
+
+}  // namespace polar_grid_rviz_plugins
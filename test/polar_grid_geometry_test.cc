@@ -0,0 +1,320 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2024 HuaTsai
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <polar_grid_rviz_plugins/polar_grid_geometry.hpp>
+#include <polar_grid_rviz_plugins/unit_circle.hpp>
+
+namespace polar_grid_rviz_plugins {
+
+  namespace {
+
+  // Written past the end of the buffers to catch writes beyond the counts.
+  constexpr float kGuardPosition = -12345.f;
+  constexpr uint32_t kGuardIndex = 0xDEADBEEF;
+  constexpr size_t kGuard = 16;
+
+  PolarGridParams makeParams(
+    int circles_count, bool sectors, int min_angle, int max_angle, bool invert)
+  {
+    PolarGridParams params;
+    params.min_radius = 0.5f;
+    params.radius_step = 2.f;
+    params.circles_count = circles_count;
+    params.sectors = sectors;
+    params.min_angle = min_angle;
+    params.max_angle = max_angle;
+    params.sector_count = 12;
+    params.invert = invert;
+    params.major_every = 5;
+    return params;
+  }
+
+  std::vector < PolarGridParams > paramsMatrix()
+  {
+    std::vector < PolarGridParams > matrix;
+    for (int circles_count : {1, 5, 16, 17, 100, 400}) {
+      matrix.push_back(makeParams(circles_count, false, -180, 180, false));
+      matrix.push_back(makeParams(circles_count, true, -180, 180, false));
+      matrix.push_back(makeParams(circles_count, true, -60, 60, false));
+      matrix.push_back(makeParams(circles_count, true, -60, 60, true));
+      matrix.push_back(makeParams(circles_count, true, 0, 360, true));
+    }
+    // Adaptive tessellation with a different level on every circle.
+    PolarGridParams levels = makeParams(40, true, -90, 135, false);
+    for (int i = 0; i < levels.circles_count; ++i) {
+      levels.ring_levels.push_back(3 + i % 11);
+    }
+    matrix.push_back(levels);
+    return matrix;
+  }
+
+  // Checks that the writer stays within the sizes of the counter and only
+  // indexes the vertices it wrote.
+  template<typename Count, typename Write>
+  void checkChunk(Count count, Write write)
+  {
+    size_t vertices = 0, indices = 0;
+    count(vertices, indices);
+    EXPECT_EQ(indices % 2, 0u);
+    std::vector < float > positions(3 * vertices + kGuard, kGuardPosition);
+    std::vector < uint32_t > index_buffer(indices + kGuard, kGuardIndex);
+    write(positions.data(), index_buffer.data());
+    for (size_t i = 3 * vertices; i < positions.size(); ++i) {
+      ASSERT_EQ(positions[i], kGuardPosition);
+    }
+    for (size_t i = indices; i < index_buffer.size(); ++i) {
+      ASSERT_EQ(index_buffer[i], kGuardIndex);
+    }
+    for (size_t i = 0; i < indices; ++i) {
+      ASSERT_LT(index_buffer[i], vertices);
+    }
+  }
+
+  }  // namespace
+
+  TEST(PolarGridGeometryTest, AngularRange)
+  {
+    float start_angle = 0.f, end_angle = 0.f;
+    angularRange(makeParams(5, false, -60, 60, false), start_angle, end_angle);
+    EXPECT_FLOAT_EQ(start_angle, 0.f);
+    EXPECT_FLOAT_EQ(end_angle, 360.f);
+
+    angularRange(makeParams(5, true, -60, 60, false), start_angle, end_angle);
+    EXPECT_FLOAT_EQ(start_angle, -60.f);
+    EXPECT_FLOAT_EQ(end_angle, 60.f);
+
+    // Inverted sectors cover the rest of the circle.
+    angularRange(makeParams(5, true, -60, 60, true), start_angle, end_angle);
+    EXPECT_FLOAT_EQ(start_angle, 60.f);
+    EXPECT_FLOAT_EQ(end_angle, 300.f);
+  }
+
+  TEST(PolarGridGeometryTest, RingSegments)
+  {
+    PolarGridParams params = makeParams(2, false, -180, 180, false);
+    EXPECT_EQ(ringSegments(params, 0, 360.f), 360);
+    EXPECT_EQ(ringSegments(params, 0, 90.f), 90);
+    EXPECT_EQ(ringSegments(params, 0, 0.5f), 1);
+    EXPECT_EQ(ringSegments(params, 0, 0.f), 0);
+    params.ring_levels = {4, 6};
+    EXPECT_EQ(ringSegments(params, 0, 360.f), 16);
+    EXPECT_EQ(ringSegments(params, 1, 180.f), 32);
+    EXPECT_EQ(ringSegments(params, 1, 1.f), 1);
+  }
+
+  TEST(PolarGridGeometryTest, SlicesStayWithinBudget)
+  {
+    for (const PolarGridParams & params : paramsMatrix()) {
+      int slices = 0;
+      for (int band = 0; band < bandCount(params); ++band) {
+        slices += bandSlices(params, band);
+      }
+      EXPECT_LE(slices, kMaxSlices);
+      EXPECT_GE(bandCount(params) * bandCircles(params), params.circles_count);
+    }
+    // Small grids are drawn in one or two slices.
+    EXPECT_EQ(bandCount(makeParams(5, false, -180, 180, false)), 1);
+    EXPECT_LE(bandSlices(makeParams(5, false, -180, 180, false), 0), 2);
+  }
+
+  TEST(PolarGridGeometryTest, CountsMatchWrites)
+  {
+    for (const PolarGridParams & params : paramsMatrix()) {
+      for (int band = 0; band < bandCount(params); ++band) {
+        for (int slice = 0; slice < bandSlices(params, band); ++slice) {
+          for (RingTier tier : {RingTier::kMajor, RingTier::kMinor}) {
+            checkChunk(
+              [&](size_t & vertices, size_t & indices) {
+                countBand(params, band, slice, tier, vertices, indices);
+              },
+              [&](float * positions, uint32_t * indices) {
+                writeBand(params, band, slice, tier, positions, indices);
+              });
+          }
+          checkChunk(
+            [&](size_t & vertices, size_t & indices) {
+              countSpokes(params, band, slice, vertices, indices);
+            },
+            [&](float * positions, uint32_t * indices) {
+              writeSpokes(params, band, slice, positions, indices);
+            });
+        }
+      }
+    }
+  }
+
+  TEST(PolarGridGeometryTest, BuildMatchesCount)
+  {
+    for (const PolarGridParams & params : paramsMatrix()) {
+      for (int band = 0; band < bandCount(params); ++band) {
+        for (int slice = 0; slice < bandSlices(params, band); ++slice) {
+          size_t vertices = 0, indices = 0;
+          PolarGridGeometry geometry;
+          countBand(params, band, slice, RingTier::kMinor, vertices, indices);
+          buildBand(params, band, slice, RingTier::kMinor, geometry);
+          EXPECT_EQ(geometry.positions.size(), 3 * vertices);
+          EXPECT_EQ(geometry.indices.size(), indices);
+          EXPECT_FALSE(geometry.spokes);
+          EXPECT_EQ(geometry.tier, RingTier::kMinor);
+
+          countSpokes(params, band, slice, vertices, indices);
+          buildSpokes(params, band, slice, geometry);
+          EXPECT_EQ(geometry.positions.size(), 3 * vertices);
+          EXPECT_EQ(geometry.indices.size(), indices);
+          EXPECT_TRUE(geometry.spokes);
+          for (size_t i = 0; i < geometry.positions.size(); i += 3) {
+            for (int j = 0; j < 3; ++j) {
+              ASSERT_GE(geometry.positions[i + j], geometry.bounds[j]);
+              ASSERT_LE(geometry.positions[i + j], geometry.bounds[j + 3]);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  TEST(PolarGridGeometryTest, CirclesLieOnTheirRings)
+  {
+    PolarGridParams params = makeParams(40, true, -60, 60, true);
+    float start_angle = 0.f, end_angle = 0.f;
+    angularRange(params, start_angle, end_angle);
+    size_t circle_vertices = 0;
+    for (int band = 0; band < bandCount(params); ++band) {
+      for (int slice = 0; slice < bandSlices(params, band); ++slice) {
+        for (RingTier tier : {RingTier::kMajor, RingTier::kMinor}) {
+          PolarGridGeometry geometry;
+          buildBand(params, band, slice, tier, geometry);
+          circle_vertices += geometry.positions.size() / 3;
+          for (size_t i = 0; i < geometry.positions.size(); i += 3) {
+            float x = geometry.positions[i], y = geometry.positions[i + 1];
+            // Nearest circle of the grid.
+            float ring = (std::hypot(x, y) - params.min_radius) / params.radius_step;
+            ASSERT_NEAR(ring, std::round(ring), 1e-4f);
+            ASSERT_EQ(geometry.positions[i + 2], 0.f);
+            // Only the inverted arc is drawn.
+            float angle = std::atan2(y, x) * 180.f / static_cast < float > (M_PI);
+            if (angle < start_angle - 1e-3f) {
+              angle += 360.f;
+            }
+            ASSERT_GE(angle, start_angle - 1e-3f);
+            ASSERT_LE(angle, end_angle + 1e-3f);
+          }
+        }
+      }
+    }
+    EXPECT_GT(circle_vertices, 0u);
+  }
+
+  TEST(PolarGridGeometryTest, SpokesCoverTheSectors)
+  {
+    for (bool full : {true, false}) {
+      PolarGridParams params = full ?
+        makeParams(100, true, -180, 180, false) : makeParams(100, true, -60, 60, true);
+      for (int band = 0; band < bandCount(params); ++band) {
+        size_t spokes = 0;
+        for (int slice = 0; slice < bandSlices(params, band); ++slice) {
+          size_t vertices = 0, indices = 0;
+          countSpokes(params, band, slice, vertices, indices);
+          spokes += vertices / 2;
+        }
+        // A full circle shares its first and last spoke.
+        EXPECT_EQ(spokes, static_cast < size_t > (params.sector_count + (full ? 0 : 1)));
+      }
+    }
+  }
+
+  TEST(PolarGridGeometryTest, InvertedFullRangeIsEmpty)
+  {
+    PolarGridParams params = makeParams(40, true, 0, 360, true);
+    for (int band = 0; band < bandCount(params); ++band) {
+      for (int slice = 0; slice < bandSlices(params, band); ++slice) {
+        size_t vertices = 0, indices = 0;
+        for (RingTier tier : {RingTier::kMajor, RingTier::kMinor}) {
+          countBand(params, band, slice, tier, vertices, indices);
+          EXPECT_EQ(vertices, 0u);
+          EXPECT_EQ(indices, 0u);
+        }
+        countSpokes(params, band, slice, vertices, indices);
+        EXPECT_EQ(vertices, 0u);
+        EXPECT_EQ(indices, 0u);
+      }
+    }
+  }
+
+  TEST(PolarGridGeometryTest, DisabledSectorsHaveNoSpokes)
+  {
+    PolarGridParams params = makeParams(40, false, -60, 60, false);
+    for (int band = 0; band < bandCount(params); ++band) {
+      for (int slice = 0; slice < bandSlices(params, band); ++slice) {
+        size_t vertices = 0, indices = 0;
+        countSpokes(params, band, slice, vertices, indices);
+        EXPECT_EQ(vertices, 0u);
+      }
+    }
+  }
+
+  // The SSE2 and NEON paths handle four points at a time, the scalar tail
+  // the rest.
+  TEST(UnitCircleTest, ScaleMatchesScalarReference)
+  {
+    for (int segments : {1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 33, 360}) {
+      std::shared_ptr < const UnitCircle > circle = getUnitCircle(-37.5f, 215.f, segments);
+      ASSERT_EQ(circle->cos.size(), static_cast < size_t > (segments + 1));
+      size_t points = circle->cos.size();
+      for (size_t count : {size_t{0}, size_t{1}, size_t{3}, size_t{4}, size_t{5},
+          points - 1, points, std::numeric_limits < size_t > ::max()})
+      {
+        size_t written = std::min(count, points);
+        std::vector < float > out(3 * points + kGuard, kGuardPosition);
+        scaleUnitCircle(*circle, 3.25f, out.data(), count);
+        for (size_t i = 0; i < written; ++i) {
+          ASSERT_FLOAT_EQ(out[3 * i], 3.25f * circle->cos[i]);
+          ASSERT_FLOAT_EQ(out[3 * i + 1], 3.25f * circle->sin[i]);
+          ASSERT_EQ(out[3 * i + 2], 0.f);
+        }
+        for (size_t i = 3 * written; i < out.size(); ++i) {
+          ASSERT_EQ(out[i], kGuardPosition);
+        }
+      }
+    }
+  }
+
+  TEST(UnitCircleTest, TablesAreShared)
+  {
+    std::shared_ptr < const UnitCircle > a = getUnitCircle(0.f, 360.f, 64);
+    std::shared_ptr < const UnitCircle > b = getUnitCircle(0.f, 360.f, 64);
+    EXPECT_EQ(a, b);
+    EXPECT_NEAR(a->cos.front(), 1.f, 1e-6f);
+    EXPECT_NEAR(a->cos.back(), 1.f, 1e-6f);
+    EXPECT_NEAR(a->sin[16], 1.f, 1e-6f);
+  }
+
+}  // namespace polar_grid_rviz_plugins